@@ -161,6 +161,13 @@ namespace bus
                         PADDR    = (address + (addressOffset * i)); // Set the address, add the offset onto the address
                         PSEL     = H;
 
+                        // The first transfer is driven before the coroutine suspends, outside 
+                        // the clock manager's resume, which marks the inputs changed after that
+                        if(i == 0)
+                        {
+                            PCLK->markInputsDirty();
+                        }
+
                         // Wait for the positive edge of the clock to transition into the access phase
                         waitPosEdge(PCLK);
 
@@ -172,7 +179,7 @@ namespace bus
                         // Wait until PREADY is in the right state and then transition out of the transaction
                         // PENABLE is already at the right state, since we set it at that point
                         // Since this is a single transaction it ends here.
-                        while (PREADY == L) waitPosEdge(PCLK);
+                        co_await waitSignal(PREADY, H, PCLK);
 
                         PENABLE  = L;
                         buffer[i] = PRDATA;
@@ -231,6 +238,13 @@ namespace bus
                         PADDR    = (address + (addressOffset * i)); // Set the address, add the offset onto the address
                         PSEL     = H;
 
+                        // The first transfer is driven before the coroutine suspends, outside 
+                        // the clock manager's resume, which marks the inputs changed after that
+                        if(i == 0)
+                        {
+                            PCLK->markInputsDirty();
+                        }
+
                         // Wait for the positive edge of the clock to transition into the access phase
                         waitPosEdge(PCLK);
 
@@ -242,7 +256,7 @@ namespace bus
                         // Wait until PREADY is in the right state and then transition out of the transaction
                         // PENABLE is already at the right state, since we set it at that point
                         // Since this is a single transaction it ends here.
-                        while (PREADY == L) waitPosEdge(PCLK);
+                        co_await waitSignal(PREADY, H, PCLK);
 
                         PENABLE  = L;
                     }
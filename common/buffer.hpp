@@ -39,6 +39,14 @@
 #define BUFFER_HPP
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <array>
+#include <span>
+#include <cassert>
 
 namespace RoaLogic
 {
@@ -49,6 +57,12 @@ namespace common
      */
     template <class T> class ringbufferIterator;
 
+    /**
+     * Up to two contiguous regions of a ring buffer, the second is empty
+     * when the region does not wrap around the end of the buffer
+     */
+    template <class T> using ringbufferSpans = std::array<std::span<T>, 2>;
+
  
     /**
      * @class ringbuffer
@@ -132,7 +146,7 @@ namespace common
              * @return The number of elements in the buffer
              */
             size_t size() {
-                if (full()) return max_size;
+                if (full()) return max_size();
                 if (_head >= _tail) return (_head - _tail);
                 return (max_size() + _head - _tail);
             }
@@ -156,6 +170,37 @@ namespace common
                 //check buffer overrung
                 if (_head == max_size()) _head = 0;
 
+                //on overwrite the oldest element is dropped
+                if (full()) _tail = _head;
+
+                //update flags
+                _empty = false;
+                _full  = _head == _tail;
+            }
+
+
+            /**
+             * @brief Move element to the end of the buffer
+             * @details Avoids copying large elements, e.g. strings
+             *
+             * @param &&data          Element to move into the buffer
+             * @param OverwriteOnFull Specify behaviour when the buffer is full. When true overwrite oldest data, otherwise ignore the request
+             */
+            void push_back(T&& data, bool OverwriteOnFull=true) {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                //check full and OverWriteOnFull
+                if (full() && !OverwriteOnFull) return;
+
+                //Move element into buffer
+                _buffer[_head++] = std::move(data);
+
+                //check buffer overrung
+                if (_head == max_size()) _head = 0;
+
+                //on overwrite the oldest element is dropped
+                if (full()) _tail = _head;
+
                 //update flags
                 _empty = false;
                 _full  = _head == _tail;
@@ -187,6 +232,84 @@ namespace common
             }
 
 
+            /**
+             * @brief  Elements available for reading, without copying
+             * @details Returns the stored elements as up to two contiguous regions
+             * of the internal buffer, oldest first. The regions stay valid until 
+             * commit_read(), the buffer must have a single consumer.
+             *
+             * Usage: auto spans = rb.read_spans();
+             *        for (auto s : spans) write(fd, s.data(), s.size_bytes());
+             *        rb.commit_read(spans[0].size() + spans[1].size());
+             *
+             * @return The readable regions
+             */
+            ringbufferSpans<T> read_spans() {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                if (empty()) return {};
+                if (_tail < _head) return {std::span<T>(&_buffer[_tail], _head - _tail), std::span<T>()};
+                return {std::span<T>(&_buffer[_tail], max_size() - _tail), std::span<T>(&_buffer[0], _head)};
+            }
+
+
+            /**
+             * @brief Remove elements read through read_spans()
+             *
+             * @param n Number of elements to remove from the front of the buffer
+             */
+            void commit_read(size_t n) {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                if (n == 0) return;
+                assert(n <= (full() ? max_size() : (_head + max_size() - _tail) % max_size()));
+
+                //advance read pointer
+                _tail = (_tail + n) % max_size();
+
+                //update flags
+                _full  = false;
+                _empty = _tail == _head;
+            }
+
+
+            /**
+             * @brief  Free space available for writing, without copying
+             * @details Returns the free space as up to two contiguous regions of the
+             * internal buffer, in write order. The regions stay valid until
+             * commit_write(), the buffer must have a single producer.
+             *
+             * @return The writable regions
+             */
+            ringbufferSpans<T> write_spans() {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                if (full()) return {};
+                if (_head < _tail) return {std::span<T>(&_buffer[_head], _tail - _head), std::span<T>()};
+                return {std::span<T>(&_buffer[_head], max_size() - _head), std::span<T>(&_buffer[0], _tail)};
+            }
+
+
+            /**
+             * @brief Add elements written through write_spans()
+             *
+             * @param n Number of elements written at the end of the buffer
+             */
+            void commit_write(size_t n) {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                if (n == 0) return;
+                assert(n <= (empty() ? max_size() : (_tail + max_size() - _head) % max_size()));
+
+                //advance write pointer
+                _head = (_head + n) % max_size();
+
+                //update flags
+                _empty = false;
+                _full  = _head == _tail;
+            }
+
+
             /**
              * @brief First element
              * @return Reference to the first element
@@ -219,6 +342,253 @@ namespace common
     };
 
 
+    //Size of a cache line, keeps the producer and consumer indices apart
+    constexpr size_t cCacheLineSize = 64;
+
+    /**
+     * @class spscRingbuffer
+     * @author Richard Herveille
+     * @brief Lock-free single-producer/single-consumer circular buffer
+     *
+     * @details Variant of ringbuffer for exactly one producer thread and one
+     * consumer thread, e.g. the simulation thread passing UART bytes to a
+     * console thread. No mutex is taken, every call completes in a bounded 
+     * number of steps.
+     *
+     * The head (write) and tail (read) indices are free running counters, each
+     * on its own cache line and only written by one side. The capacity is
+     * rounded up to a power of two, so an index is mapped onto the buffer by
+     * masking and full/empty follow from the difference of the indices.
+     *
+     * Each side keeps a cached copy of the other side's index and only reloads
+     * the atomic index when the cached copy says the buffer is full (producer)
+     * or empty (consumer).
+     *
+     * Only the producer may call push_back() and push_n(), only the consumer
+     * may call pop_front(), pop_n() and clear().
+     */
+    template <class T=uint8_t> class spscRingbuffer
+    {
+        private:
+            using buffer_t = std::unique_ptr<T[]>;
+
+            /**
+             * @brief Round up to a power of two
+             */
+            static size_t roundUp(size_t size)
+            {
+                size_t capacity = 1;
+                while (capacity < size) capacity <<= 1;
+                return capacity;
+            }
+
+            const size_t _maxSize;  //maximum number of elements, a power of two
+            const size_t _mask;     //maps an index onto the buffer
+            buffer_t     _buffer;   //buffer of elements
+
+            alignas(cCacheLineSize) std::atomic<size_t> _head; //write index, written by the producer
+            size_t                                      _tailCache; //producer's copy of the read index
+
+            alignas(cCacheLineSize) std::atomic<size_t> _tail; //read index, written by the consumer
+            size_t                                      _headCache; //consumer's copy of the write index
+
+        public:
+            /**
+             * @brief Constructor
+             * @param size  Minimum number of elements, rounded up to a power of two
+             */
+            spscRingbuffer(size_t size) : _maxSize(roundUp(size)),
+                                          _mask(_maxSize - 1),
+                                          _buffer(std::unique_ptr<T[]>(new T[_maxSize])),
+                                          _head(0),
+                                          _tailCache(0),
+                                          _tail(0),
+                                          _headCache(0) {}
+
+            spscRingbuffer(const spscRingbuffer&) = delete;
+            spscRingbuffer& operator=(const spscRingbuffer&) = delete;
+
+
+            /**
+             * @brief Clears buffer
+             * @details Discards all elements, must be called by the consumer
+             */
+            void clear() {
+                _headCache = _head.load(std::memory_order_acquire);
+                _tail.store(_headCache, std::memory_order_release);
+            }
+
+
+            /**
+             * @brief  Is the buffer full?
+             * @return true when buffer is full, false otherwise
+             */
+            bool full() const { return size() == _maxSize; }
+
+
+            /**
+             * @brief  Is the buffer empty?
+             * @return true when buffer is empty, false otherwise
+             */
+            bool empty() const { return size() == 0; }
+
+
+            /**
+             * @brief  The maximum number of elements that can be stored in the buffer
+             * @return Maximum number of elements that can be stored in the buffer
+             */
+            size_t max_size() const { return _maxSize; }
+
+
+            /**
+             * @brief  Returns the number of elements stored in the buffer
+             * @details The result is a snapshot, the other thread may change it
+             * @return The number of elements in the buffer
+             */
+            size_t size() const {
+                return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+            }
+
+
+            /**
+             * @brief Insert element at the end of the buffer
+             *
+             * @param &data           Element to insert into the buffer
+             * @return true when inserted, false when the buffer is full
+             */
+            bool push_back(const T& data) {
+                return push_n(&data, 1) == 1;
+            }
+
+
+            /**
+             * @brief Insert elements at the end of the buffer
+             *
+             * @param *data   Elements to insert into the buffer
+             * @param n       Number of elements
+             * @return The number of elements inserted, less than n when the buffer is full
+             */
+            size_t push_n(const T* data, size_t n) {
+                const size_t head = _head.load(std::memory_order_relaxed);
+
+                //refresh the read index only when the buffer looks full
+                if (_maxSize - (head - _tailCache) < n) {
+                    _tailCache = _tail.load(std::memory_order_acquire);
+                }
+
+                size_t count = std::min(n, _maxSize - (head - _tailCache));
+
+                //copy in at most two contiguous parts
+                size_t first = std::min(count, _maxSize - (head & _mask));
+                std::copy(data, data + first, &_buffer[head & _mask]);
+                std::copy(data + first, data + count, &_buffer[0]);
+
+                //publish the elements
+                _head.store(head + count, std::memory_order_release);
+                return count;
+            }
+
+
+            /**
+             * @brief Retrieve element from the front of the buffer
+             *
+             * @param &data   Receives the element
+             * @return true when an element was retrieved, false when the buffer is empty
+             */
+            bool pop_front(T& data) {
+                return pop_n(&data, 1) == 1;
+            }
+
+
+            /**
+             * @brief Retrieve elements from the front of the buffer
+             *
+             * @param *data   Receives the elements
+             * @param n       Maximum number of elements
+             * @return The number of elements retrieved
+             */
+            size_t pop_n(T* data, size_t n) {
+                const size_t tail = _tail.load(std::memory_order_relaxed);
+
+                //refresh the write index only when the buffer looks empty
+                if (_headCache - tail < n) {
+                    _headCache = _head.load(std::memory_order_acquire);
+                }
+
+                size_t count = std::min(n, _headCache - tail);
+
+                //copy out at most two contiguous parts
+                size_t first = std::min(count, _maxSize - (tail & _mask));
+                std::copy(&_buffer[tail & _mask], &_buffer[tail & _mask] + first, data);
+                std::copy(&_buffer[0], &_buffer[0] + (count - first), data + first);
+
+                //release the slots
+                _tail.store(tail + count, std::memory_order_release);
+                return count;
+            }
+
+
+            /**
+             * @brief  Elements available for reading, without copying
+             * @details Returns the stored elements as up to two contiguous regions
+             * of the internal buffer, oldest first. Must be called by the consumer,
+             * the regions stay valid until commit_read().
+             *
+             * @return The readable regions
+             */
+            ringbufferSpans<T> read_spans() {
+                const size_t tail = _tail.load(std::memory_order_relaxed);
+                _headCache = _head.load(std::memory_order_acquire);
+
+                size_t count = _headCache - tail;
+                size_t first = std::min(count, _maxSize - (tail & _mask));
+                return {std::span<T>(&_buffer[tail & _mask], first), std::span<T>(&_buffer[0], count - first)};
+            }
+
+
+            /**
+             * @brief Remove elements read through read_spans()
+             *
+             * @param n Number of elements to remove from the front of the buffer
+             */
+            void commit_read(size_t n) {
+                const size_t tail = _tail.load(std::memory_order_relaxed);
+                assert(n <= _headCache - tail);
+                _tail.store(tail + n, std::memory_order_release);
+            }
+
+
+            /**
+             * @brief  Free space available for writing, without copying
+             * @details Returns the free space as up to two contiguous regions of the
+             * internal buffer, in write order. Must be called by the producer,
+             * the regions stay valid until commit_write().
+             *
+             * @return The writable regions
+             */
+            ringbufferSpans<T> write_spans() {
+                const size_t head = _head.load(std::memory_order_relaxed);
+                _tailCache = _tail.load(std::memory_order_acquire);
+
+                size_t count = _maxSize - (head - _tailCache);
+                size_t first = std::min(count, _maxSize - (head & _mask));
+                return {std::span<T>(&_buffer[head & _mask], first), std::span<T>(&_buffer[0], count - first)};
+            }
+
+
+            /**
+             * @brief Add elements written through write_spans()
+             *
+             * @param n Number of elements written at the end of the buffer
+             */
+            void commit_write(size_t n) {
+                const size_t head = _head.load(std::memory_order_relaxed);
+                assert(n <= _maxSize - (head - _tailCache));
+                _head.store(head + n, std::memory_order_release);
+            }
+    };
+
+
 
 
 
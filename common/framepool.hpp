@@ -0,0 +1,266 @@
+/////////////////////////////////////////////////////////////////////
+//   ,------.                    ,--.                ,--.          //
+//   |  .--. ' ,---.  ,--,--.    |  |    ,---. ,---. `--' ,---.    //
+//   |  '--'.'| .-. |' ,-.  |    |  |   | .-. | .-. |,--.| .--'    //
+//   |  |\  \ ' '-' '\ '-'  |    |  '--.' '-' ' '-' ||  |\ `--.    //
+//   `--' '--' `---'  `--`--'    `-----' `---' `-   /`--' `---'    //
+//                                             `---'               //
+//    Coroutine Frame Pool Allocator                               //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//             Copyright (C) 2024 Roa Logic BV                     //
+//             www.roalogic.com                                    //
+//                                                                 //
+//     This source file may be used and distributed without        //
+//   restriction provided that this copyright statement is not     //
+//   removed from the file and that any derivative work contains   //
+//   the original copyright notice and the associated disclaimer.  //
+//                                                                 //
+//      THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY        //
+//   EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED     //
+//   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS     //
+//   FOR A PARTICULAR PURPOSE. IN NO EVENT SHALL THE AUTHOR        //
+//   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,           //
+//   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES      //
+//   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE     //
+//   GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR          //
+//   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    //
+//   LIABILITY, WHETHER IN  CONTRACT, STRICT LIABILITY, OR TORT    //
+//   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT    //
+//   OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE           //
+//   POSSIBILITY OF SUCH DAMAGE.                                   //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+
+#ifndef FRAMEPOOL_HPP
+#define FRAMEPOOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace RoaLogic
+{
+namespace common
+{
+
+    /**
+     * @brief Frame pool statistics
+     */
+    struct sFramePoolStats
+    {
+        uint64_t allocated;  //!< Frames allocated from the global allocator
+        uint64_t reused;     //!< Frames taken from a free list
+        uint64_t released;   //!< Frames returned to a free list
+        uint64_t oversized;  //!< Frames too large for the pool, passed to the global allocator
+    };
+
+    /**
+     * @class cFramePool
+     * @author Richard Herveille
+     * @brief Size-class pool allocator for coroutine frames
+     *
+     * @details Each call of a coroutine function allocates a coroutine frame.
+     * Bus transactions are coroutines, so stimulus loops allocate and free
+     * millions of small frames of only a few different sizes.
+     *
+     * The pool rounds the size up to a multiple of cGranularity and keeps a free
+     * list per size class. A released frame is pushed on its free list and
+     * handed out again by the next allocation of the same size class, so once
+     * the number of live frames is stable no memory is allocated.
+     *
+     * There is one pool per thread, see local(), so no locking is needed.
+     * Frames larger than cMaxFrameSize are passed to the global allocator.
+     *
+     * A frame can outlive the pool of its thread, e.g. a frame owned by a static
+     * object is released after the thread's pool is destroyed. allocateFrame() and
+     * releaseFrame() then use the global allocator.
+     */
+    class cFramePool
+    {
+        public:
+            static constexpr size_t cGranularity  = 64;                         //!< Size class granularity in bytes
+            static constexpr size_t cSizeClasses  = 16;                         //!< Number of size classes
+            static constexpr size_t cMaxFrameSize = cGranularity * cSizeClasses; //!< Largest pooled frame size
+
+        private:
+            /**
+             * @brief Free frame, the link is stored in the frame itself
+             */
+            struct sFreeFrame
+            {
+                sFreeFrame* next;
+            };
+
+            sFreeFrame*     _freeList[cSizeClasses]; //!< Free list per size class
+            sFramePoolStats _stats;                  //!< Allocation statistics
+
+            /**
+             * @brief Lifetime of the pool of a thread
+             * @details Trivially destructible, so it can be read after the pool is destroyed
+             */
+            enum class ePoolState : uint8_t
+            {
+                Unused,     //!< local() was not called yet
+                Alive,      //!< The pool exists
+                Destroyed   //!< The pool is destroyed, use the global allocator
+            };
+
+            static inline thread_local ePoolState _state = ePoolState::Unused;
+
+            /**
+             * @brief Size class of a frame size
+             */
+            static size_t sizeClass(size_t size)
+            {
+                return (size - 1) / cGranularity;
+            }
+
+        public:
+            /**
+             * @brief Construct an empty frame pool
+             */
+            cFramePool() : _freeList{}, _stats{}
+            {
+                _state = ePoolState::Alive;
+            }
+
+            cFramePool(const cFramePool&) = delete;
+            cFramePool& operator=(const cFramePool&) = delete;
+
+            /**
+             * @brief Destructor, returns all free frames to the global allocator
+             */
+            ~cFramePool()
+            {
+                _state = ePoolState::Destroyed;
+
+                for (auto& list : _freeList)
+                {
+                    while (list)
+                    {
+                        sFreeFrame* frame = list;
+                        list = frame->next;
+                        ::operator delete(frame);
+                    }
+                }
+            }
+
+            /**
+             * @brief The frame pool of the calling thread
+             */
+            static cFramePool& local()
+            {
+                static thread_local cFramePool pool;
+                return pool;
+            }
+
+            /**
+             * @brief Allocate a frame from the pool of the calling thread
+             * @details Uses the global allocator when the pool is already destroyed
+             *
+             * @param[in] size  Size of the frame in bytes
+             * @return Pointer to the frame
+             */
+            static void* allocateFrame(size_t size)
+            {
+                if (_state == ePoolState::Destroyed)
+                {
+                    return ::operator new(size);
+                }
+
+                return local().allocate(size);
+            }
+
+            /**
+             * @brief Release a frame to the pool of the calling thread
+             * @details Uses the global allocator when the pool is already destroyed.
+             * Pooled frames are allocated by the global allocator too, so they can
+             * always be deleted.
+             *
+             * @param[in] ptr   Pointer to the frame
+             * @param[in] size  Size of the frame in bytes
+             */
+            static void releaseFrame(void* ptr, size_t size) noexcept
+            {
+                if (_state == ePoolState::Destroyed)
+                {
+                    ::operator delete(ptr);
+                    return;
+                }
+
+                local().release(ptr, size);
+            }
+
+            /**
+             * @brief Allocate a frame
+             *
+             * @param[in] size  Size of the frame in bytes
+             * @return Pointer to the frame
+             */
+            void* allocate(size_t size)
+            {
+                if (size == 0 || size > cMaxFrameSize)
+                {
+                    _stats.oversized++;
+                    return ::operator new(size);
+                }
+
+                size_t sc = sizeClass(size);
+
+                if (sFreeFrame* frame = _freeList[sc])
+                {
+                    _freeList[sc] = frame->next;
+                    _stats.reused++;
+                    return frame;
+                }
+
+                _stats.allocated++;
+                return ::operator new((sc + 1) * cGranularity);
+            }
+
+            /**
+             * @brief Release a frame
+             * @details The size must be the size passed to allocate()
+             *
+             * @param[in] ptr   Pointer to the frame
+             * @param[in] size  Size of the frame in bytes
+             */
+            void release(void* ptr, size_t size) noexcept
+            {
+                if (size == 0 || size > cMaxFrameSize)
+                {
+                    ::operator delete(ptr);
+                    return;
+                }
+
+                size_t sc = sizeClass(size);
+
+                sFreeFrame* frame = static_cast<sFreeFrame*>(ptr);
+                frame->next = _freeList[sc];
+                _freeList[sc] = frame;
+                _stats.released++;
+            }
+
+            /**
+             * @brief Get the allocation statistics
+             */
+            const sFramePoolStats& getStats() const
+            {
+                return _stats;
+            }
+
+            /**
+             * @brief Clear the allocation statistics
+             */
+            void clearStats()
+            {
+                _stats = {};
+            }
+    };
+
+}
+}
+
+#endif
@@ -35,6 +35,8 @@
 
 #include <log.hpp>
 #include <iostream>
+#include <chrono>
+#include <cstdlib>
 
 namespace RoaLogic
 {
@@ -155,6 +157,7 @@ namespace common
 
             _logFileName = fileName;
             _logPriority = aPriority;
+            _enabledPriority = aPriority;
             _initialized = true;
             _logMutex.unlock();
         }
@@ -166,6 +169,9 @@ namespace common
      */
     void cLog::close()
     {
+        stopAsync();
+        _binary = false;
+
         if(_saveToFile)
         {
             try
@@ -187,17 +193,29 @@ namespace common
      * 
      * @param msg 
      */
-    void cLog::appendStream(std::string msg)
+    void cLog::appendStream(std::string_view msg)
     {
         if(_initialized)
         {
             if (_currentMsgPriority == eLogPriority::Fatal)
             {
-                throw std::runtime_error(msg);
+                //The handler is called once, it might log itself
+                if (_fatalHandler)
+                {
+                    std::function<void()> handler = std::move(_fatalHandler);
+                    _fatalHandler = nullptr;
+                    handler();
+                }
+
+                throw std::runtime_error(std::string(msg));
             }
             else
             {
-                if(_saveToFile)
+                if(_async || _binary)
+                {
+                    messageStream() << msg;
+                }
+                else if(_saveToFile)
                 {
                     _logMutex.lock();
 
@@ -233,6 +251,12 @@ namespace common
     {
         if(aPriority >= _logPriority)
         {
+            //Hand off an unterminated previous message of this thread
+            if((_async || _binary) && aPriority != eLogPriority::Append)
+            {
+                commitMessage();
+            }
+
             _currentMsgPriority = aPriority;
 
             switch (aPriority)
@@ -261,6 +285,22 @@ namespace common
             default:
                 break;
             } 
+
+            //Stamp with the simulation time, the formatted time is reused while the time does not change
+            if(_time && aPriority != eLogPriority::Append)
+            {
+                int64_t ticks = timeTicks();
+
+                if(ticks != _stampTicks)
+                {
+                    _stampTicks = ticks;
+                    _stamp = "@";
+                    formatSimTicks(_stamp, ticks, _time->logPrecision());
+                    _stamp += " ";
+                }
+
+                appendStream(_stamp);
+            }
         }
         else
         {
@@ -270,8 +310,465 @@ namespace common
         return *this;
     }
 
-}
-}
+    /**
+     * @brief Start asynchronous logging
+     * @details From now on messages are formatted into a buffer of the logging
+     * thread. A complete message, one ending with a newline, is pushed into a 
+     * lock-free queue and written to the console or file by a writer thread,
+     * so the simulation thread does not wait for the output.
+     * 
+     * The queue holds at most queueSize bytes. When it is full the message is 
+     * either dropped (counted by getDropped()) or the logging thread waits for
+     * the writer thread.
+     * 
+     * @param queueSize     Size of the queue in bytes
+     * @param overflow      Behaviour when the queue is full
+     */
+    void cLog::startAsync(size_t queueSize, eLogOverflow overflow)
+    {
+        if(!_async)
+        {
+            _queue = std::make_unique<spscRingbuffer<char>>(queueSize);
+            _overflow = overflow;
+            _dropped = 0;
+            _writerRun = true;
+            _writer = std::thread(&cLog::asyncWriter, this);
+            _async = true;
+
+            if(!_exitHook)
+            {
+                std::atexit(&cLog::exitHook);
+                _exitHook = true;
+            }
+        }
+    }
+
+    /**
+     * @brief Stop asynchronous logging
+     * @details Hands off the pending message of the calling thread, waits until
+     * the writer thread wrote all queued messages and returns to synchronous logging.
+     */
+    void cLog::stopAsync()
+    {
+        if(_async)
+        {
+            commitMessage();
+            stopWriter();
+        }
+    }
+
+    /**
+     * @brief Stop the writer thread
+     * @details Waits until the writer thread wrote all queued messages
+     */
+    void cLog::stopWriter()
+    {
+        _async = false;
+
+        _writerRun = false;
+        _writer.join();
+        _queue.reset();
+    }
+
+    /**
+     * @brief Stop the writer thread at program exit
+     * @details Registered with atexit() by startAsync(), so the queued messages
+     * are written and the thread is joined when close() or stopAsync() is not 
+     * called. The pending message of the main thread is not handed off, its 
+     * thread_local buffer is already destroyed.
+     */
+    void cLog::exitHook()
+    {
+        if(_myPointer && _myPointer->_async)
+        {
+            _myPointer->stopWriter();
+        }
+    }
+
+    /**
+     * @brief The message buffer of the calling thread
+     * @details Used by the << interface in asynchronous and binary mode
+     * 
+     * @return std::ostringstream& 
+     */
+    std::ostringstream& cLog::messageStream()
+    {
+        static thread_local std::ostringstream stream;
+        return stream;
+    }
+
+    /**
+     * @brief The buffer to format LOG_FORMAT messages as text
+     * 
+     * @return std::ostringstream& 
+     */
+    std::ostringstream& cLog::formatStream()
+    {
+        static thread_local std::ostringstream stream;
+        return stream;
+    }
 
+    /**
+     * @brief The buffer to build binary log records
+     * 
+     * @return std::string& 
+     */
+    std::string& cLog::recordBuffer()
+    {
+        static thread_local std::string record;
+        return record;
+    }
+
+    /**
+     * @brief Hand off the message buffer of the calling thread
+     * @details In binary mode the message is wrapped in a text record.
+     * The buffer's memory is reused for the next message.
+     */
+    void cLog::commitMessage()
+    {
+        std::ostringstream& stream = messageStream();
+
+        if(!stream.view().empty())
+        {
+            std::string msg = std::move(stream).str();
+
+            if(_binary)
+            {
+                std::string& record = recordBuffer();
+                record.clear();
 
+                binLogPut(record, eBinLogRecord::Text);
+                binLogPut(record, static_cast<uint32_t>(msg.size()));
+                record.append(msg);
 
+                writeOutput(record);
+            }
+            else
+            {
+                writeOutput(msg);
+            }
+
+            msg.clear();
+            stream.str(std::move(msg));
+        }
+    }
+
+    /**
+     * @brief Write to the log output
+     * @details Passes the data to the writer thread in asynchronous mode,
+     * otherwise writes it to the file or console
+     * 
+     * @param data  The data to write
+     */
+    void cLog::writeOutput(std::string_view data)
+    {
+        if(_async)
+        {
+            asyncPush(data);
+        }
+        else if(_saveToFile)
+        {
+            std::lock_guard<std::mutex> lock(_logMutex);
+
+            try
+            {
+                _fileStream.write(data.data(), data.size());
+            }
+            catch(const std::ifstream::failure& e)
+            {
+                throw std::runtime_error(std::string("File failure: ") + e.what());
+            }
+        }
+        else
+        {
+            std::cout << data;
+        }
+    }
+
+    /**
+     * @brief Push a message into the queue
+     * @details The queue has a single producer and a single consumer, the 
+     * writer thread. The _queueBusy flag is the serialization point of the 
+     * producing threads: a thread spins with yield() until it owns the flag.
+     * It is uncontended when only the simulation thread logs, so a push costs
+     * one atomic exchange instead of a mutex lock.
+     * 
+     * @param msg   The message
+     */
+    void cLog::asyncPush(std::string_view msg)
+    {
+        while(_queueBusy.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+
+        if(_overflow == eLogOverflow::Drop)
+        {
+            auto spans = _queue->write_spans();
+
+            if(spans[0].size() + spans[1].size() < msg.size())
+            {
+                _dropped++;
+            }
+            else
+            {
+                _queue->push_n(msg.data(), msg.size());
+            }
+        }
+        else
+        {
+            //Messages larger than the queue are pushed in parts
+            while(!msg.empty())
+            {
+                size_t n = _queue->push_n(msg.data(), msg.size());
+                msg.remove_prefix(n);
+
+                if(!msg.empty())
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        _queueBusy.clear(std::memory_order_release);
+    }
+
+    /**
+     * @brief Writer thread
+     * @details Writes the queued messages directly from the queue to the console
+     * or file. When the queue is empty it flushes the output and polls again.
+     * Stops when asynchronous logging is stopped and the queue is empty.
+     */
+    void cLog::asyncWriter()
+    {
+        std::ostream& out = _saveToFile ? static_cast<std::ostream&>(_fileStream) : std::cout;
+
+        while(true)
+        {
+            //Check the flag first, messages pushed before stopAsync() are then in the queue
+            bool run = _writerRun;
+
+            auto spans = _queue->read_spans();
+            size_t n = spans[0].size() + spans[1].size();
+
+            if(n)
+            {
+                try
+                {
+                    for(auto span : spans)
+                    {
+                        out.write(span.data(), span.size());
+                    }
+                }
+                catch(const std::ios_base::failure& e)
+                {
+                    std::cerr << "[ERROR] Log file failure: " << e.what() << "\n";
+                }
+
+                _queue->commit_read(n);
+            }
+            else if(run)
+            {
+                out.flush();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        out.flush();
+    }
+
+    /**
+     * @brief Start writing the binary log format
+     * @details Messages are no longer formatted as text. LOG_FORMAT messages 
+     * are written as the id of their format string, the simulation time and 
+     * the raw argument bytes, << messages as text records. Use the logdecode 
+     * tool to render the file as text.
+     * 
+     * Must be called after init() with a file name. The log file is reopened 
+     * truncated in binary mode, so text logged before and the contents of an
+     * earlier run are discarded. The binary format is used until close().
+     */
+    void cLog::startBinary()
+    {
+        if(!_saveToFile)
+        {
+            ERROR << "Binary log needs a log file\n";
+            return;
+        }
+
+        if(!_binary)
+        {
+            //The writer thread writes to the file, stop it while reopening
+            bool async = _async;
+            size_t queueSize = async ? _queue->max_size() : 0;
+            stopAsync();
+
+            _logMutex.lock();
+            _fileStream.close();
+
+            try
+            {
+                _fileStream.open(_logFileName, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+            }
+            catch(const std::ofstream::failure& e)
+            {
+                _logMutex.unlock();
+                throw std::runtime_error(std::string("File open failed: ") + e.what());
+            }
+
+            _logMutex.unlock();
+
+            if(async)
+            {
+                startAsync(queueSize, _overflow);
+            }
+
+            std::string& header = recordBuffer();
+            header.assign(cBinLogMagic, sizeof(cBinLogMagic));
+            binLogPut(header, cBinLogVersion);
+            writeOutput(header);
+
+            //Format records must be written again in the new file
+            std::lock_guard<std::mutex> lock(_formatMutex);
+            for(auto& format : _formats)
+            {
+                format.written = false;
+            }
+
+            _binary = true;
+            writePrecision();
+        }
+    }
+
+    /**
+     * @brief Set the source of the simulation time
+     * @details Every message is stamped with the simulation time, in text
+     * as @<ticks><unit> after the priority, e.g. "[INFO] @1250000ps ".
+     * 
+     * Usage: cLog::getInstance()->setTimeInterface(&testbench);
+     * 
+     * @param time  The time source, e.g. the testbench, nullptr to remove it
+     */
+    void cLog::setTimeInterface(cLogTime* time)
+    {
+        _time = time;
+        _stampTicks = -1;
+
+        if(_binary)
+        {
+            writePrecision();
+        }
+    }
+
+    /**
+     * @brief Set the fatal handler
+     * @details The handler is called on the first FATAL message, before the
+     * exception is thrown, e.g. to save a flight recorder trace
+     * 
+     * @param handler   The handler, nullptr to remove it
+     */
+    void cLog::setFatalHandler(std::function<void()> handler)
+    {
+        _fatalHandler = std::move(handler);
+    }
+
+    /**
+     * @brief Get the source of the simulation time
+     * 
+     * @return The time source, nullptr when not set
+     */
+    cLogTime* cLog::getTimeInterface() const
+    {
+        return _time;
+    }
+
+    /**
+     * @brief Get the simulation time in ticks
+     * 
+     * @return The simulation time, cBinLogNoTime when no time source is set
+     */
+    int64_t cLog::timeTicks()
+    {
+        return _time ? _time->logTicks() : cBinLogNoTime;
+    }
+
+    /**
+     * @brief Write the precision of the time source to the binary log
+     * @details The time stamps of the following messages are in ticks of this precision
+     */
+    void cLog::writePrecision()
+    {
+        if(_time)
+        {
+            std::string& record = recordBuffer();
+            record.clear();
+            binLogPut(record, eBinLogRecord::Precision);
+            binLogPut(record, _time->logPrecision());
+            writeOutput(record);
+        }
+    }
+
+    /**
+     * @brief Register the format string of a LOG_FORMAT call site
+     * 
+     * @param aPriority The priority of the call site
+     * @param format    The format string
+     * @param args      The argument types
+     * @return The registered format, its address does not change
+     */
+    cLog::sFormat* cLog::registerFormat(eLogPriority aPriority, const char* format, std::initializer_list<eBinLogArg> args)
+    {
+        std::lock_guard<std::mutex> lock(_formatMutex);
+
+        sFormat& f = _formats.emplace_back();
+        f.id       = static_cast<uint32_t>(_formats.size() - 1);
+        f.priority = aPriority;
+        f.format   = format;
+        f.args     = args;
+        f.written  = false;
+
+        return &f;
+    }
+
+    /**
+     * @brief Write a binary log message record
+     * @details The format record is written first when the format was not
+     * used in the file yet
+     * 
+     * @param format    The format of the message
+     * @param record    The message record
+     */
+    void cLog::writeRecord(sFormat* format, std::string_view record)
+    {
+        if(!format->written)
+        {
+            std::lock_guard<std::mutex> lock(_formatMutex);
+
+            if(!format->written)
+            {
+                std::string def;
+                binLogPut(def, eBinLogRecord::Format);
+                binLogPut(def, format->id);
+                binLogPut(def, static_cast<uint8_t>(format->priority));
+                binLogPut(def, static_cast<uint8_t>(format->args.size()));
+                for(auto arg : format->args)
+                {
+                    binLogPut(def, arg);
+                }
+                binLogPut(def, static_cast<uint32_t>(format->format.size()));
+                def.append(format->format);
+
+                writeOutput(def);
+                format->written = true;
+            }
+        }
+
+        writeOutput(record);
+    }
+
+}
+}
@@ -40,19 +40,76 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <string_view>
+#include <initializer_list>
+#include <buffer.hpp>
+#include <logformat.hpp>
 
-#define DEBUG   RoaLogic::common::cLog::getInstance()->log(RoaLogic::common::eLogPriority::Debug)
-#define LOG     RoaLogic::common::cLog::getInstance()->log(RoaLogic::common::eLogPriority::Log)
-#define INFO    RoaLogic::common::cLog::getInstance()->log(RoaLogic::common::eLogPriority::Info)
-#define WARNING RoaLogic::common::cLog::getInstance()->log(RoaLogic::common::eLogPriority::Warning)
-#define ERROR   RoaLogic::common::cLog::getInstance()->log(RoaLogic::common::eLogPriority::Error)
-#define FATAL   RoaLogic::common::cLog::getInstance()->log(RoaLogic::common::eLogPriority::Fatal)
-#define APPEND  RoaLogic::common::cLog::getInstance()->log(RoaLogic::common::eLogPriority::Append)
+/**
+ * Lowest log priority that is compiled in, as the number of the eLogPriority.
+ * Messages below it are removed by the compiler, e.g. define LOG_MIN_PRIORITY=2
+ * to remove all DEBUG and LOG messages.
+ */
+#ifndef LOG_MIN_PRIORITY
+#define LOG_MIN_PRIORITY 0
+#endif
+
+/**
+ * The log macros only evaluate the message when the priority is enabled. A disabled
+ * message costs one compare with the cached log priority, the singleton is not looked
+ * up and the arguments of the << chain are not evaluated.
+ */
+#define LOG_PRIORITY(prio) \
+    if (!RoaLogic::common::cLog::enabled(prio)) ; else RoaLogic::common::cLog::getInstance()->log(prio)
+
+#define DEBUG   LOG_PRIORITY(RoaLogic::common::eLogPriority::Debug)
+#define LOG     LOG_PRIORITY(RoaLogic::common::eLogPriority::Log)
+#define INFO    LOG_PRIORITY(RoaLogic::common::eLogPriority::Info)
+#define WARNING LOG_PRIORITY(RoaLogic::common::eLogPriority::Warning)
+#define ERROR   LOG_PRIORITY(RoaLogic::common::eLogPriority::Error)
+#define FATAL   LOG_PRIORITY(RoaLogic::common::eLogPriority::Fatal)
+#define APPEND  LOG_PRIORITY(RoaLogic::common::eLogPriority::Append)
+
+/**
+ * Log a message with a format string, {} is replaced by the next argument.
+ * Usage: DEBUGF("APB4 bus({}) write {} to {}\n", id, data, address);
+ * 
+ * In binary mode only the id of the format string, the simulation time and the
+ * raw argument bytes are written, otherwise the message is formatted as text.
+ * The lambda gives every call site its own format string id.
+ */
+#define LOG_FORMAT(prio, ...) \
+    if (!RoaLogic::common::cLog::enabled(prio)) ; else RoaLogic::common::cLog::getInstance()->logFormat([]{}, prio, __VA_ARGS__)
+
+#define DEBUGF(...)   LOG_FORMAT(RoaLogic::common::eLogPriority::Debug,   __VA_ARGS__)
+#define LOGF(...)     LOG_FORMAT(RoaLogic::common::eLogPriority::Log,     __VA_ARGS__)
+#define INFOF(...)    LOG_FORMAT(RoaLogic::common::eLogPriority::Info,    __VA_ARGS__)
+#define WARNINGF(...) LOG_FORMAT(RoaLogic::common::eLogPriority::Warning, __VA_ARGS__)
+#define ERRORF(...)   LOG_FORMAT(RoaLogic::common::eLogPriority::Error,   __VA_ARGS__)
 
 namespace RoaLogic
 {
 namespace common
 {
+    /**
+     * @class cLogTime
+     * @brief Source of the time stamp of log messages
+     * 
+     * @details Implemented by testbench::cTimeInterface, the log only
+     * needs the time in ticks and the precision of a tick
+     */
+    class cLogTime
+    {
+        public:
+        virtual int64_t logTicks() = 0;      //!< Current time in ticks
+        virtual int8_t  logPrecision() = 0;  //!< A tick is 10^precision seconds
+    };
     
     enum class eLogPriority
     {
@@ -65,6 +122,18 @@ namespace common
         Append
     };
 
+    /**
+     * @brief Behaviour of the asynchronous log when its queue is full
+     */
+    enum class eLogOverflow
+    {
+        Block,  //!< Wait until the writer thread made room
+        Drop    //!< Drop the message
+    };
+
+    //Default size of the asynchronous log queue in bytes
+    constexpr size_t cLogQueueSize = 1 << 20;
+
     /**
      * @brief 
      * 
@@ -81,22 +150,96 @@ namespace common
         std::ofstream _fileStream;
         std::mutex _logMutex;
         static cLog* _myPointer;
+        static inline eLogPriority _enabledPriority = eLogPriority::Error; //!< Copy of _logPriority for enabled()
+
+        bool _async = false;                          //!< Messages are written by the writer thread
+        eLogOverflow _overflow = eLogOverflow::Block; //!< Queue full policy
+        std::unique_ptr<spscRingbuffer<char>> _queue; //!< Formatted messages for the writer thread
+        std::atomic_flag _queueBusy;                  //!< Spin lock serializing threads pushing into the queue
+        std::atomic<bool> _writerRun{false};          //!< Writer thread keeps running
+        std::atomic<uint64_t> _dropped{0};            //!< Messages dropped because the queue was full
+        std::thread _writer;                          //!< Writer thread
+        bool _exitHook = false;                       //!< exitHook() registered with atexit()
+
+        /**
+         * @brief Format string of a LOG_FORMAT call site
+         */
+        struct sFormat
+        {
+            uint32_t                id;        //!< Id in the binary log
+            eLogPriority            priority;  //!< Priority of the call site
+            std::string             format;    //!< The format string
+            std::vector<eBinLogArg> args;      //!< Argument types
+            std::atomic<bool>       written;   //!< Format record written to the binary log
+        };
+
+        bool _binary = false;                         //!< Write the binary log format
+        std::deque<sFormat> _formats;                 //!< Registered format strings, stable addresses
+        std::mutex _formatMutex;                      //!< Protects _formats and format record output
+        cLogTime* _time = nullptr;                    //!< Source of the simulation time
+        int64_t _stampTicks = -1;                     //!< Time of the cached time stamp
+        std::function<void()> _fatalHandler;          //!< Called once on the first FATAL message
+        std::string _stamp;                           //!< Cached time stamp text
 
         cLog();
 
         cLog& operator=(const cLog&){ return *this; };  // assignment operator is private
 
-        void appendStream(std::string msg);
+        void appendStream(std::string_view msg);
         eLogPriority convertPriority(uint8_t prio); 
 
+        static std::ostringstream& messageStream();
+        static std::ostringstream& formatStream();
+        static std::string& recordBuffer();
+        void commitMessage();
+        void writeOutput(std::string_view data);
+        void asyncPush(std::string_view msg);
+        void asyncWriter();
+        void stopWriter();
+        static void exitHook();
+
+        sFormat* registerFormat(eLogPriority aPriority, const char* format, std::initializer_list<eBinLogArg> args);
+        void writeRecord(sFormat* format, std::string_view record);
+        int64_t timeTicks();
+        void writePrecision();
+
+        template <typename T>
+        static void formatArg(std::ostringstream& stream, const T& arg);
+
         public:
 
         static cLog* getInstance();
 
+        /**
+         * @brief Check if a log priority is enabled
+         * @details Does not need the instance, so the log macros can skip
+         * disabled messages without looking up the singleton
+         * 
+         * @param aPriority The priority of the message
+         * @return true when messages with this priority are logged
+         */
+        static bool enabled(eLogPriority aPriority)
+        {
+            return static_cast<int>(aPriority) >= LOG_MIN_PRIORITY && aPriority >= _enabledPriority;
+        }
+
         void init(uint8_t aPriority, std::string fileName);
         void init(eLogPriority aPriority, std::string fileName);
         void close();
 
+        void startAsync(size_t queueSize = cLogQueueSize, eLogOverflow overflow = eLogOverflow::Block);
+        void stopAsync();
+        uint64_t getDropped() const { return _dropped; }
+
+        void startBinary();
+        void setTimeInterface(cLogTime* time);
+        cLogTime* getTimeInterface() const;
+
+        void setFatalHandler(std::function<void()> handler);
+
+        template <typename Site, typename... Args>
+        void logFormat(Site, eLogPriority aPriority, const char* format, const Args&... args);
+
         cLog& log(eLogPriority aPriority);
         
         template <typename T>
@@ -115,7 +258,19 @@ namespace common
     {
         if(_currentMsgPriority >= _logPriority )
         {
-            if(_saveToFile)
+            if(_async || _binary)
+            {
+                std::ostringstream& stream = messageStream();
+                stream << msg;
+
+                //A message is complete at the end of a line
+                std::string_view view = stream.view();
+                if(!view.empty() && view.back() == '\n')
+                {
+                    commitMessage();
+                }
+            }
+            else if(_saveToFile)
             {
                 _fileStream << msg;
             }
@@ -128,6 +283,81 @@ namespace common
         return *this;
     }
 
+    /**
+     * @brief Format an argument of a LOG_FORMAT message as text
+     * @details Bytes are formatted as numbers, as the binary log decoder does
+     */
+    template <typename T>
+    void cLog::formatArg(std::ostringstream& stream, const T& arg)
+    {
+        constexpr eBinLogArg type = binLogArg<T>();
+
+        if constexpr (type == eBinLogArg::Int8 || type == eBinLogArg::UInt8)
+        {
+            stream << +arg;
+        }
+        else
+        {
+            stream << arg;
+        }
+    }
+
+    /**
+     * @brief Log a message with a format string
+     * @details Called by the LOG_FORMAT macros. The format string is registered
+     * once per call site, the Site type is unique for every call site.
+     * 
+     * In binary mode a message record is written, holding the id of the format
+     * string, the simulation time and the raw argument bytes. Otherwise every {} 
+     * in the format string is replaced by the next argument and the message is
+     * logged as text.
+     * 
+     * @param aPriority The priority of the message
+     * @param format    The format string, must be the same for every call
+     * @param args      The arguments
+     */
+    template <typename Site, typename... Args>
+    void cLog::logFormat(Site, eLogPriority aPriority, const char* format, const Args&... args)
+    {
+        static sFormat* const site = registerFormat(aPriority, format, {binLogArg<Args>()...});
+
+        if(_binary)
+        {
+            std::string& record = recordBuffer();
+            record.clear();
+
+            binLogPut(record, eBinLogRecord::Message);
+            binLogPut(record, site->id);
+            binLogPut(record, timeTicks());
+            (binLogEncode(record, args), ...);
+
+            writeRecord(site, record);
+        }
+        else
+        {
+            std::ostringstream& stream = formatStream();
+            stream.str("");
+
+            std::string_view fmt(format);
+            size_t pos = 0;
+
+            auto next = [&](const auto& arg)
+            {
+                size_t p = fmt.find("{}", pos);
+                if(p == std::string_view::npos) return;
+
+                stream << fmt.substr(pos, p - pos);
+                formatArg(stream, arg);
+                pos = p + 2;
+            };
+
+            (next(args), ...);
+            stream << fmt.substr(pos);
+
+            log(aPriority) << stream.view();
+        }
+    }
+
 }
 }
 
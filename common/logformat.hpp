@@ -0,0 +1,192 @@
+/////////////////////////////////////////////////////////////////////
+//   ,------.                    ,--.                ,--.          //
+//   |  .--. ' ,---.  ,--,--.    |  |    ,---. ,---. `--' ,---.    //
+//   |  '--'.'| .-. |' ,-.  |    |  |   | .-. | .-. |,--.| .--'    //
+//   |  |\  \ ' '-' '\ '-'  |    |  '--.' '-' ' '-' ||  |\ `--.    //
+//   `--' '--' `---'  `--`--'    `-----' `---' `-   /`--' `---'    //
+//                                             `---'               //
+//    Binary Log Format                                            //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//             Copyright (C) 2024 Roa Logic BV                     //
+//             www.roalogic.com                                    //
+//                                                                 //
+//     This source file may be used and distributed without        //
+//   restriction provided that this copyright statement is not     //
+//   removed from the file and that any derivative work contains   //
+//   the original copyright notice and the associated disclaimer.  //
+//                                                                 //
+//      THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY        //
+//   EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED     //
+//   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS     //
+//   FOR A PARTICULAR PURPOSE. IN NO EVENT SHALL THE AUTHOR        //
+//   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,           //
+//   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES      //
+//   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE     //
+//   GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR          //
+//   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    //
+//   LIABILITY, WHETHER IN  CONTRACT, STRICT LIABILITY, OR TORT    //
+//   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT    //
+//   OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE           //
+//   POSSIBILITY OF SUCH DAMAGE.                                   //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+
+#ifndef LOGFORMAT_HPP
+#define LOGFORMAT_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace RoaLogic
+{
+namespace common
+{
+    /*
+     * Binary log file layout, all values in native byte order
+     *
+     * Header:            magic[8] version:u32
+     * Format record:     Format:u8 id:u32 priority:u8 argc:u8 argType[argc]:u8 length:u32 format[length]
+     * Message record:    Message:u8 id:u32 time:i64 args
+     * Text record:       Text:u8 length:u32 text[length]
+     * Precision record:  Precision:u8 precision:i8
+     *
+     * A format record is written once per file, before the first message using it.
+     * Numbers are stored as their raw bytes, strings as length:u32 followed by the characters.
+     * The time is in ticks of 10^precision seconds, the precision record is written when
+     * the time source is set. Messages logged without a time source have time cBinLogNoTime.
+     */
+    constexpr char     cBinLogMagic[8] = {'R','L','B','I','N','L','O','G'};
+    constexpr uint32_t cBinLogVersion  = 2;
+    constexpr int64_t  cBinLogNoTime   = INT64_MIN;
+
+    /**
+     * @brief Binary log record types
+     */
+    enum class eBinLogRecord : uint8_t
+    {
+        Format    = 1,  //!< Format string definition
+        Message   = 2,  //!< Message using a format string
+        Text      = 3,  //!< Text message, from the << interface
+        Precision = 4   //!< Precision of the following time stamps
+    };
+
+    /**
+     * @brief Binary log argument types
+     */
+    enum class eBinLogArg : uint8_t
+    {
+        Bool,
+        Char,
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Int64,
+        UInt64,
+        Float,
+        Double,
+        String
+    };
+
+    /**
+     * @brief Binary log argument type of a C++ type
+     */
+    template <typename T>
+    constexpr eBinLogArg binLogArg()
+    {
+        using U = std::decay_t<T>;
+
+        if constexpr (std::is_same_v<U, bool>)                  return eBinLogArg::Bool;
+        else if constexpr (std::is_same_v<U, char>)             return eBinLogArg::Char;
+        else if constexpr (std::is_enum_v<U>)                   return binLogArg<std::underlying_type_t<U>>();
+        else if constexpr (std::is_integral_v<U>)
+        {
+            constexpr bool s = std::is_signed_v<U>;
+            if constexpr (sizeof(U) == 1)                       return s ? eBinLogArg::Int8  : eBinLogArg::UInt8;
+            else if constexpr (sizeof(U) == 2)                  return s ? eBinLogArg::Int16 : eBinLogArg::UInt16;
+            else if constexpr (sizeof(U) == 4)                  return s ? eBinLogArg::Int32 : eBinLogArg::UInt32;
+            else                                                return s ? eBinLogArg::Int64 : eBinLogArg::UInt64;
+        }
+        else if constexpr (std::is_same_v<U, float>)            return eBinLogArg::Float;
+        else if constexpr (std::is_floating_point_v<U>)         return eBinLogArg::Double;
+        else
+        {
+            static_assert(std::is_convertible_v<const T&, std::string_view>, "Unsupported binary log argument type");
+            return eBinLogArg::String;
+        }
+    }
+
+    /**
+     * @brief Append raw bytes to a binary log record
+     */
+    template <typename T>
+    inline void binLogPut(std::string& record, const T& value)
+    {
+        record.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+     * @brief Append an argument to a binary log record
+     */
+    template <typename T>
+    inline void binLogEncode(std::string& record, const T& value)
+    {
+        constexpr eBinLogArg type = binLogArg<T>();
+
+        if constexpr (type == eBinLogArg::String)
+        {
+            std::string_view str(value);
+            binLogPut(record, static_cast<uint32_t>(str.size()));
+            record.append(str);
+        }
+        else if constexpr (type == eBinLogArg::Double)
+        {
+            binLogPut(record, static_cast<double>(value));
+        }
+        else if constexpr (std::is_enum_v<std::decay_t<T>>)
+        {
+            binLogPut(record, static_cast<std::underlying_type_t<std::decay_t<T>>>(value));
+        }
+        else
+        {
+            binLogPut(record, value);
+        }
+    }
+
+    /**
+     * @brief Append a simulation time as an integer with its unit
+     * @details Avoids floating point, e.g. 1234567 ticks with precision -12 gives "1234567ps"
+     * 
+     * @param out       String to append to
+     * @param ticks     Time in ticks
+     * @param precision A tick is 10^precision seconds
+     */
+    inline void formatSimTicks(std::string& out, int64_t ticks, int precision)
+    {
+        char buf[24];
+        out.append(buf, std::to_chars(buf, buf + sizeof(buf), ticks).ptr);
+
+        switch (precision)
+        {
+            case   0: out += "s";  break;
+            case  -3: out += "ms"; break;
+            case  -6: out += "us"; break;
+            case  -9: out += "ns"; break;
+            case -12: out += "ps"; break;
+            case -15: out += "fs"; break;
+            case -18: out += "as"; break;
+            default : out += "e" + std::to_string(precision) + "s"; break;
+        }
+    }
+}
+}
+
+#endif
@@ -0,0 +1,200 @@
+/////////////////////////////////////////////////////////////////////
+//   ,------.                    ,--.                ,--.          //
+//   |  .--. ' ,---.  ,--,--.    |  |    ,---. ,---. `--' ,---.    //
+//   |  '--'.'| .-. |' ,-.  |    |  |   | .-. | .-. |,--.| .--'    //
+//   |  |\  \ ' '-' '\ '-'  |    |  '--.' '-' ' '-' ||  |\ `--.    //
+//   `--' '--' `---'  `--`--'    `-----' `---' `-   /`--' `---'    //
+//                                             `---'               //
+//    Scope list option derived from base option                   //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//             Copyright (C) 2024 Roa Logic BV                     //
+//             www.roalogic.com                                    //
+//                                                                 //
+//     This source file may be used and distributed without        //
+//   restriction provided that this copyright statement is not     //
+//   removed from the file and that any derivative work contains   //
+//   the original copyright notice and the associated disclaimer.  //
+//                                                                 //
+//      THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY        //
+//   EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED     //
+//   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS     //
+//   FOR A PARTICULAR PURPOSE. IN NO EVENT SHALL THE AUTHOR        //
+//   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,           //
+//   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES      //
+//   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE     //
+//   GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR          //
+//   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    //
+//   LIABILITY, WHETHER IN  CONTRACT, STRICT LIABILITY, OR TORT    //
+//   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT    //
+//   OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE           //
+//   POSSIBILITY OF SUCH DAMAGE.                                   //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+
+#ifndef SCOPEOPTION_HPP
+#define SCOPEOPTION_HPP
+
+#include <programOptions.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <log.hpp>
+
+namespace RoaLogic
+{
+namespace common
+{
+
+    /**
+     * @brief Option with a list of hierarchical scopes to include and exclude
+     * @details The value is a comma separated list of scopes. A scope starting
+     * with '-' is excluded, any other scope, optionally starting with '+', is 
+     * included. The option can be given multiple times.
+     * 
+     * Usage: --trace-scope=TOP.soc.bus,-TOP.soc.bus.debug
+     */
+    class cScopeOption : public cOption
+    {
+        protected:
+            std::vector<std::string> _includes;
+            std::vector<std::string> _excludes;
+
+            void parse(cOptionName what_name, const char* value);
+            void clear();
+
+        public:
+
+            cScopeOption(const std::string& aShortOption, 
+                         const std::string& aLongOption, 
+                         const std::string& aDescription);
+
+            eArgument getArgumentType();
+            size_t optionCount();
+            bool isSet();
+
+            const std::vector<std::string>& includes() const;
+            const std::vector<std::string>& excludes() const;
+    };
+
+    /**
+     * @brief Construct a new scope option object
+     * 
+     * @param aShortOption the option's short name. Must be empty or one character. 
+     * @param aLongOption the option's long name. Can be empty.
+     * @param aDescription the Option's description that will be shown in the help message
+     */
+    inline cScopeOption::cScopeOption( const std::string& aShortOption, 
+                                       const std::string& aLongOption, 
+                                       const std::string& aDescription) :
+        cOption(aShortOption, aLongOption, aDescription)
+    {
+
+    }
+
+    /**
+     * @brief Get the option's argument type
+     * 
+     * @return eArgument    The argument type as enum
+     */
+    inline eArgument cScopeOption::getArgumentType()
+    {
+        return eArgument::required;
+    }
+
+    /**
+     * @brief Get the number of scopes
+     * 
+     * @return size_t   The number of included and excluded scopes
+     */
+    inline size_t cScopeOption::optionCount()
+    {
+        return _includes.size() + _excludes.size();
+    }
+
+    /**
+     * @brief Check if any scope is set
+     * 
+     * @return true     At least one scope is set
+     * @return false    No scopes are set
+     */
+    inline bool cScopeOption::isSet()
+    {
+        return optionCount() != 0;
+    }
+
+    /**
+     * @brief Get the scopes to include
+     */
+    inline const std::vector<std::string>& cScopeOption::includes() const
+    {
+        return _includes;
+    }
+
+    /**
+     * @brief Get the scopes to exclude
+     */
+    inline const std::vector<std::string>& cScopeOption::excludes() const
+    {
+        return _excludes;
+    }
+
+    /**
+     * @brief Parse the comma separated list of scopes
+     * 
+     * @param what_name     Name of the option
+     * @param value         The list of scopes
+     */
+    inline void cScopeOption::parse(cOptionName what_name, const char* value)
+    {
+        std::stringstream ss(value != nullptr ? value : "");
+        std::string scope;
+
+        while (std::getline(ss, scope, ','))
+        {
+            if (scope.empty())
+            {
+                continue;
+            }
+
+            if (scope[0] == '-')
+            {
+                _excludes.push_back(scope.substr(1));
+            }
+            else if (scope[0] == '+')
+            {
+                _includes.push_back(scope.substr(1));
+            }
+            else
+            {
+                _includes.push_back(scope);
+            }
+        }
+
+        if (!isSet())
+        {
+            if(what_name == cOptionName::shortOption)
+            {
+                FATAL << "No scope for: " << this->getShortName();
+            }
+            else
+            {
+                FATAL << "No scope for: " << this->getLongName();
+            }
+        }
+    }
+
+    /**
+     * @brief Clear the scopes
+     * 
+     */
+    inline void cScopeOption::clear()
+    {
+        _includes.clear();
+        _excludes.clear();
+    }
+}
+}
+
+#endif
@@ -57,7 +57,14 @@ cUart::cUart(cClock* clkInput, uint8_t& TXpin, uint8_t& RXpin) :
 {
     // Bit time is 1 / Baudrate 
     simtime_t bitRate = (1.0 / _myBaudrate); // Make implicit double by using 1.0 instead of 1
-    _numberOfClocksToWait = (bitRate/CLK->getPeriod());
+    simtime_t period = CLK->getPeriod();
+    _numberOfClocksToWait = (period == 0) ? 0 : (bitRate/period);
+
+    // A bit must last at least one clock, else receiveByte() cannot sample it
+    if (_numberOfClocksToWait == 0)
+    {
+        ERROR << "UART bit time " << bitRate << " is shorter than the clock period " << period << "\n";
+    }
 
     #ifdef DBG_UART_H
     DEBUG << "UART baudrate: "<< _myBaudrate << " Num clocks for single bit: " << _numberOfClocksToWait << "\n";
@@ -68,36 +75,32 @@ sCoRoutineHandler<eUartErrorCode> cUart::receiveByte()
 {
     // Check if the TX signal is high, else we are already receiving a byte
     eUartErrorCode result = TX ? eUartErrorCode::Succesfull : eUartErrorCode::Busy;
-    uint32_t numberOfClockTicks = 0;
+
+    // The baudrate cannot be sampled with this clock, see constructor
+    if (_numberOfClocksToWait == 0)
+    {
+        result = eUartErrorCode::ConfigError;
+    }
+
     uint8_t currentByte = 0;
     #ifdef DBG_UART_H
-    uint64_t clockCount = 0;
+    uint64_t clockStart = CLK->getCycleCount();
     #endif
     
     if(result == eUartErrorCode::Succesfull)
     {
         // Wait for the start bit, which is indicated by a High to low transition
+        // The clock checks TX, this coroutine is only resumed on the first low sample
         do
         {
-            waitPosEdge(CLK);
-            #ifdef DBG_UART_H
-            clockCount++;
-            #endif
+            co_await waitSignal(TX, L, CLK);
 
-            if(TX == L)
-            {
-                numberOfClockTicks++;
-            }
-            else
-            {
-                numberOfClockTicks = 0;
-            }
-            
-        // Make sure that the startbit is low until the middle of the sequence    
-        } while (numberOfClockTicks < (_numberOfClocksToWait/2.0));
+            // Make sure that the startbit is still low in the middle of the sequence
+            waitCycles(CLK, (_numberOfClocksToWait + 1) / 2 - 1);
+        } while (TX != L);
 
         #ifdef DBG_UART_H
-        DEBUG << "UART startbit received, clockCount: " << clockCount <<  "\n";
+        DEBUG << "UART startbit received, clockCount: " << (CLK->getCycleCount() - clockStart) <<  "\n";
         #endif
 
         // Now loop for the number of bits to receive
@@ -105,19 +108,13 @@ sCoRoutineHandler<eUartErrorCode> cUart::receiveByte()
         {
             // Wait untill the middle of the element before reading and storing it
             // The synchornization with the middle is done during the startbit
-            for (size_t y = 0; y < _numberOfClocksToWait; y++)
-            {
-                waitPosEdge(CLK);
-                #ifdef DBG_UART_H
-                clockCount++;
-                #endif
-            }
+            waitCycles(CLK, _numberOfClocksToWait);
             
             // Read bit
             currentByte |= ((TX & 0x01 ) << i);
 
             #ifdef DBG_UART_H
-            DEBUG << "UART Bit: " << i << " bit value: " << static_cast<int>(TX) << " ClockCount: " << clockCount << " \n";
+            DEBUG << "UART Bit: " << i << " bit value: " << static_cast<int>(TX) << " ClockCount: " << (CLK->getCycleCount() - clockStart) << " \n";
             #endif
         }
 
@@ -136,13 +133,7 @@ sCoRoutineHandler<eUartErrorCode> cUart::receiveByte()
         {
             // Wait untill the middle of the element before reading and storing it
             // The synchornization with the middle is done during the startbit
-            for (size_t y = 0; y < _numberOfClocksToWait; y++)
-            {
-                waitPosEdge(CLK);
-                #ifdef DBG_UART_H
-                clockCount++;
-                #endif
-            }
+            waitCycles(CLK, _numberOfClocksToWait);
             
             // Read bit
             if(TX == L)
@@ -155,7 +146,7 @@ sCoRoutineHandler<eUartErrorCode> cUart::receiveByte()
     }
 
     #ifdef DBG_UART_H
-    DEBUG << "Clockcount: " << clockCount << "\n";
+    DEBUG << "Clockcount: " << (CLK->getCycleCount() - clockStart) << "\n";
     #endif
 
     co_return result;
@@ -55,7 +55,8 @@ namespace uart
         Busy,
         NoData,
         ReceiveError,
-        StopBitError
+        StopBitError,
+        ConfigError
     };
 
     /**
@@ -40,6 +40,7 @@
 #include <uniqueid.hpp>
 
 #include <coroutine>
+#include <vector>
 #include <queue>
 #include <cassert>
 #include <log.hpp>
@@ -67,8 +68,14 @@ namespace clock
         negative
     };
 
+    class cClockManager;
+
+    //Initial capacity of the clock wait queues
+    constexpr size_t cWaitQueueReserve = 8;
+
     #define waitPosEdge(clk) co_await cClockAwaitable(clk, eClockEdge::positive); 
     #define waitNegEdge(clk) co_await cClockAwaitable(clk, eClockEdge::negative); 
+    #define waitCycles(clk, n) co_await cCyclesAwaitable(clk, n);
 
     /**
      * @class cClock
@@ -81,48 +88,145 @@ namespace clock
      * 
      * Next to this it will also check if there is a coroutine waiting for a positive or negative edge, if this
      * is the case the coroutine will be resumed.
+     * 
+     * The class is final and has no virtual functions, the clock manager stores its clocks by value
+     * and calls them directly.
      */
-    class cClock : common::cUniqueId
+    class cClock final : common::cUniqueId
     {
+        friend class cClockManager;
+
         private:
         bool        _running;         //!< Current state of the clock
         uint8_t&    _clk;             //!< Points to testbench clock variable
         simtime_t  _lowPeriod;        //!< Clock Low Period in seconds
         simtime_t  _highPeriod;       //!< Clock High Period in seconds
-        simtime_t  _timeToNextEvent;  //!< Time until next event
-        simtime_t  _precision;        //!< Time precision to toggle the clock
+        simtime_t  _nextEventTime;    //!< Absolute time of the next event
+        bool*      _inputsDirty;      //!< Clock manager's dirty flag, set when model inputs change
+        std::vector<std::coroutine_handle<>>* _readyQueue; //!< Clock manager's run queue, coroutines to resume
+        uint64_t   _cycles;           //!< Number of positive edges since construction
 
-        std::queue<std::coroutine_handle<>> posedgeQueue; //!< Positive edge coroutine queue
-        std::queue<std::coroutine_handle<>> negedgeQueue; //!< Negative edge coroutine queue
+        std::vector<std::coroutine_handle<>> posedgeQueue; //!< Positive edge coroutine queue
+        std::vector<std::coroutine_handle<>> negedgeQueue; //!< Negative edge coroutine queue
+
+        /**
+         * @brief Coroutine waiting for a number of cycles
+         * @details The order makes coroutines waiting for the same cycle
+         * resume in the order they started waiting
+         */
+        struct sCycleWaiter
+        {
+            uint64_t cycle;             //!< Cycle count to resume at
+            uint64_t order;             //!< Order in which the waits were registered
+            std::coroutine_handle<> h;  //!< Waiting coroutine
+
+            bool operator>(const sCycleWaiter& rhs) const
+            {
+                return (cycle == rhs.cycle) ? (order > rhs.order) : (cycle > rhs.cycle);
+            }
+        };
+
+        std::priority_queue<sCycleWaiter, std::vector<sCycleWaiter>, std::greater<sCycleWaiter>> cycleQueue; //!< Cycle count coroutine queue
+        uint64_t   _cycleWaitOrder;   //!< Number of cycle waits registered
+
+        /**
+         * @brief Coroutine waiting for a signal value
+         * @details The signal is type erased, match() is instantiated for the
+         * type of the signal and compares it with the value
+         */
+        struct sSignalWaiter
+        {
+            eClockEdge  edge;                              //!< Edge to check the signal on
+            const void* signal;                            //!< Pointer to the signal
+            uint64_t    value;                             //!< Value to wait for
+            bool (*match)(const void* signal, uint64_t value); //!< Compare signal with value
+            std::coroutine_handle<> h;                     //!< Waiting coroutine
+        };
+
+        std::vector<sSignalWaiter> signalQueue;  //!< Signal coroutine queue
+        std::vector<sSignalWaiter> signalBuffer; //!< Signal waiters being checked, swapped with signalQueue
 
         /**
          * @brief Toggle the clock pin
          * @details Within this function the clock pin is toggled
+         * It is called by the clock manager when the simulation time
+         * reaches the time of the next event.
          * 
          * It inverses the current state, toggling the pin
-         * Following this it sets the time to the next event, according
+         * Following this it sets the time of the next event, according
          * to the set high and low period
          * 
-         * At last it checks the state of the pin and resumes any
-         * waiting coroutines by calling the appropiate handler
+         * Waiting coroutines are not resumed here, the clock manager first
+         * toggles all clocks with an edge at the same time and then calls 
+         * resumeWaiting() for each of them.
          */
         void toggle(void)
         {
             //toggle clock
             _clk = !_clk;
 
-            //Update TimeKeep
-            _timeToNextEvent = _clk ? _highPeriod : _lowPeriod;
+            //count cycles on the positive edge
+            _cycles += _clk;
+
+            //Schedule next event
+            _nextEventTime += _clk ? _highPeriod : _lowPeriod;
+        }
 
+        /**
+         * @brief Resume coroutines waiting for the last edge
+         * @details This function checks the state of the pin and resumes 
+         * any waiting coroutines by calling the appropiate handler
+         * 
+         * The coroutines are not resumed directly, they are added to the
+         * run queue of the clock manager, which resumes them once all clocks
+         * with an edge at this time are toggled.
+         */
+        void resumeWaiting(void)
+        {
             //call routines waiting for posedge/negedge
             if (_clk)
             {
                 resumeWaitForPosedge();
+                resumeWaitForCycles();
             }
             else
             {
                 resumeWaitForNegedge();
             }
+
+            resumeWaitForSignals(_clk ? eClockEdge::positive : eClockEdge::negative);
+        }
+
+        /**
+         * @brief Resume a coroutine
+         * @details The coroutine is added to the clock manager's run queue
+         * 
+         * @param[in] h     Handle to the coroutine
+         */
+        void resume(std::coroutine_handle<> h)
+        {
+            _readyQueue->push_back(h);
+        }
+
+        /**
+         * @brief Resume the coroutines in a wait queue
+         * @details The coroutines in the wait queue are moved to the run queue
+         * and the wait queue is cleared.
+         * 
+         * Coroutines that wait again, once resumed, are added to the (empty) 
+         * wait queue and are for the next edge of the clock. The wait queue 
+         * keeps its capacity, so no memory is allocated once the number of 
+         * waiting coroutines is stable.
+         * 
+         * @param[in] queue The wait queue to resume
+         */
+        void resumeQueue(std::vector<std::coroutine_handle<>>& queue)
+        {
+            if(!queue.empty())
+            {
+                _readyQueue->insert(_readyQueue->end(), queue.begin(), queue.end());
+                queue.clear();
+            }
         }
 
         /**
@@ -134,31 +238,66 @@ namespace clock
          * It will check if there are any coroutines waiting for a positive
          * edge, if this is the case it will resume all the waiting coroutines
          * in the queue.
-         * 
-         * Note that a copy of the queue is needed, due that when resuming coroutines 
-         * new coroutines are added into the queue again, looping them around. When 
-         * there is a copy, we can handle the copy and the newly added coroutines
-         * are for the next edge of the clock
          */
         void resumeWaitForPosedge()
         {
-            if(!posedgeQueue.empty())
+            resumeQueue(posedgeQueue);
+        }
+
+        /**
+         * @brief Resume functions waiting for a number of cycles
+         * @details This function must be called on a positive edge, after the
+         * cycle count is updated. It resumes all coroutines whose countdown
+         * expired.
+         * 
+         * Coroutines that wait again are at least one cycle further, so they are
+         * not resumed in this call.
+         */
+        void resumeWaitForCycles()
+        {
+            while (!cycleQueue.empty() && cycleQueue.top().cycle <= _cycles)
             {
-                // Create a new temporary empty queue
-                std::queue<std::coroutine_handle<>> queueCopy;
+                std::coroutine_handle<> h = cycleQueue.top().h;
+                cycleQueue.pop();
 
-                // Swap empty queue and posedgeQueue
-                posedgeQueue.swap(queueCopy);
+                //resume the coroutine
+                resume(h);
+            }
+        }
+
+        /**
+         * @brief Resume functions waiting for a signal value
+         * @details This function checks the signals of all coroutines waiting
+         * on this edge and resumes the ones whose signal has the value.
+         * 
+         * The coroutines are not resumed just to check a signal, the check is
+         * done by the clock. Like the edge queues, the signal queue is swapped 
+         * with a buffer so that coroutines that wait again are checked on the 
+         * next edge.
+         * 
+         * @param[in] edge  The edge that occured
+         */
+        void resumeWaitForSignals(eClockEdge edge)
+        {
+            if (!signalQueue.empty())
+            {
+                signalBuffer.swap(signalQueue);
 
-                do
+                for (const auto& waiter : signalBuffer)
                 {
-                    //pop the function from the queue
-                    std::coroutine_handle<> h = queueCopy.front();
-                    queueCopy.pop();
+                    if (waiter.edge == edge && waiter.match(waiter.signal, waiter.value))
+                    {
+                        //resume the coroutine
+                        resume(waiter.h);
+                    }
+                    else
+                    {
+                        //keep waiting
+                        signalQueue.push_back(waiter);
+                    }
+                }
 
-                    //resume the coroutine
-                    h.resume();
-                } while (!queueCopy.empty());
+                signalBuffer.clear();
             }
         }
 
@@ -171,32 +310,10 @@ namespace clock
          * It will check if there are any coroutines waiting for a negative
          * edge, if this is the case it will resume all the waiting coroutines
          * in the queue.
-         * 
-         * Note that a copy of the queue is needed, due that when resuming coroutines 
-         * new coroutines are added into the queue again, looping them around. When 
-         * there is a copy, we can handle the copy and the newly added coroutines
-         * are for the next edge of the clock
          */
         void resumeWaitForNegedge()
         {
-            if(!negedgeQueue.empty())
-            {
-                // Create a new temporary empty queue
-                std::queue<std::coroutine_handle<>> queueCopy;
-
-                // Swap empty queue and posedgeQueue
-                negedgeQueue.swap(queueCopy);
-
-                do
-                {
-                    //pop the function from the queue
-                    std::coroutine_handle<> h = queueCopy.front();
-                    queueCopy.pop();
-
-                    //resume the coroutine
-                    h.resume();
-                } while (!queueCopy.empty());
-            }
+            resumeQueue(negedgeQueue);
         }
 
         public:
@@ -210,29 +327,38 @@ namespace clock
          * starts from 0 (low)
          * 
          * @param[in] clk         A reference to a clock pin
-         * @param[in] precision   Precision setting of the clock      
          * @param[in] LowPeriod   The low period of the clock
          * @param[in] HighPeriod  The high period of the clock
          * @param[in] runnig      The clock is directly running, default is running
          */
-        cClock(uint8_t& clk, simtime_t precision, simtime_t LowPeriod, simtime_t HighPeriod, bool running = true) :
+        cClock(uint8_t& clk, simtime_t LowPeriod, simtime_t HighPeriod, bool running = true) :
             _clk(clk),
-            _precision(precision),
             _lowPeriod(LowPeriod),
             _highPeriod(HighPeriod),
-            _running(running)
+            _running(running),
+            _inputsDirty(nullptr),
+            _readyQueue(nullptr),
+            _cycles(0),
+            _cycleWaitOrder(0)
         {
             //set clock low
             _clk = 0;
 
+            //reserve room for the wait queues
+            posedgeQueue.reserve(cWaitQueueReserve);
+            negedgeQueue.reserve(cWaitQueueReserve);
+            signalQueue.reserve(cWaitQueueReserve);
+            signalBuffer.reserve(cWaitQueueReserve);
+
             assert(LowPeriod >= 0);
             assert(HighPeriod >= 0);
 
-            //clock is low, so TimeToNextEvent is LowPeriod
-            _timeToNextEvent = LowPeriod;
+            //clock is low, so the first event is after LowPeriod
+            //the clock manager offsets this with the time the clock is added
+            _nextEventTime = LowPeriod;
 
             #ifdef DBG_CLOCK_H
-            DEBUG << "CLOCK_H (" << id() << ") constructor lvl=" << (unsigned)_clk << " LowPeriod=" << _timeToNextEvent << "\n";
+            DEBUG << "CLOCK_H (" << id() << ") constructor lvl=" << (unsigned)_clk << " LowPeriod=" << _lowPeriod << "\n";
             #endif
         }
 
@@ -241,7 +367,7 @@ namespace clock
          * @brief Destroy the cClock object
          * 
          */
-        virtual ~cClock(void) 
+        ~cClock(void) 
         {
             #ifdef DBG_CLOCK_H
             DEBUG << "CLOCK_H (" << id() << ") destructor\n";
@@ -251,7 +377,7 @@ namespace clock
         /**
          * @brief Enable the clock to trigger the signal
          */
-        virtual void enable(void)
+        void enable(void)
         {
             _running = true;
         }
@@ -259,7 +385,7 @@ namespace clock
         /**
          * @brief Disable the clock from triggering the signal
          */
-        virtual void disable(void)
+        void disable(void)
         {
             _running = false;
         }
@@ -270,7 +396,7 @@ namespace clock
          * @param[in] Period  The low period to set  
          * @return The new low period
          */
-        virtual simtime_t setLowPeriod(simtime_t Period)
+        simtime_t setLowPeriod(simtime_t Period)
         {
             _lowPeriod = Period;
             return _lowPeriod;
@@ -282,7 +408,7 @@ namespace clock
          * 
          * @return The low period
          */
-        virtual simtime_t getLowPeriod(void) const
+        simtime_t getLowPeriod(void) const
         {
             return _lowPeriod;
         }
@@ -294,7 +420,7 @@ namespace clock
          * @param[in] Period  The high period to set  
          * @return The new high period
          */
-        virtual simtime_t setHighPeriod(simtime_t Period)
+        simtime_t setHighPeriod(simtime_t Period)
         {
             _highPeriod = Period;
             return _highPeriod;
@@ -306,7 +432,7 @@ namespace clock
          * 
          * @return The high period
          */
-        virtual simtime_t getHighPeriod(void) const
+        simtime_t getHighPeriod(void) const
         {
             return _highPeriod;
         }
@@ -317,7 +443,7 @@ namespace clock
          * 
          * @return Period of the clock
          */
-        virtual simtime_t getPeriod(void) const
+        simtime_t getPeriod(void) const
         {
             return (_lowPeriod + _highPeriod);
         }
@@ -328,67 +454,63 @@ namespace clock
          * 
          * @return Frequency of the clock
          */
-        virtual long double getFrequency(void) const
+        long double getFrequency(void) const
         {
             return getPeriod().frequency();
         }
 
 
         /**
-         * @brief Get the Time To Next Event
+         * @brief Get the Time of the Next Event
          * 
-         * @return The time untill the next event
+         * @return The absolute simulation time of the next clock edge
          */
-        virtual simtime_t getTimeToNextEvent(void) const
+        simtime_t getNextEventTime(void) const
         {
             #ifdef DBG_CLOCK_H
-            DEBUG << "CLOCK_H(" << id() << ") - getTimeToNextEvent:" << _timeToNextEvent << "\n";
+            DEBUG << "CLOCK_H(" << id() << ") - getNextEventTime:" << _nextEventTime << "\n";
             #endif
 
-            return _timeToNextEvent;
+            return _nextEventTime;
         }
 
-
         /**
-         * @brief Update the time
-         * @details This function updates the time of the clock
+         * @brief Check if the clock is running
          * 
-         * The clock manager controls the clocks and tells them the time that 
-         * has passed. This time is then subtracted from the time to next event,
-         * by this we know what time we are. If the time of the clock is smaller
-         * then the precision we must toggle the clock. 
-         * 
-         * Note: When time is smaller then the precision we can't show it
-         * any better in the waveform, so we can toggle the clock already.
+         * @return true when the clock is enabled
+         */
+        bool running(void) const
+        {
+            return _running;
+        }
+
+        /**
+         * @brief Get the number of clock cycles
          * 
-         * @param[in] TimePassed The time that has passed since previous function
-         * @return The time untill the next event
+         * @return The number of positive edges since the clock was created
          */
-        virtual simtime_t updateTime(simtime_t TimePassed)
+        uint64_t getCycleCount(void) const
         {
-            #ifdef DBG_CLOCK_H
-            DEBUG << "CLOCK_H(" << id() << ") updateTime(" << TimePassed << ")\n";
-            #endif
+            return _cycles;
+        }
 
-            if(_running)
+        /**
+         * @brief Mark the model inputs as changed
+         * @details Drivers must call this after changing inputs of the verilated
+         * model outside of the clock itself. When the testbench tracks evaluations
+         * it only calls eval() on the model when inputs are marked as changed.
+         * 
+         * Clock toggles mark the inputs themselves.
+         */
+        void markInputsDirty(void)
+        {
+            if (_inputsDirty)
             {
-                //Subtract time-passed from the time until the next event
-                _timeToNextEvent -= TimePassed;
-
-                //_TimeToNextEvent should never be negative
-                assert(_timeToNextEvent >= 0);
-
-                //It's possible that there are some small rouding errors in the 
-                //calculation so therefore use a window of the given precision and 0
-                if (_timeToNextEvent >= 0 && _timeToNextEvent < _precision) 
-                {
-                    toggle();
-                }
+                *_inputsDirty = true;
             }
-
-            return _timeToNextEvent;
         }
 
+
         /**
          * @brief Wait for clock edge
          * @details This function add a coroutine handle to
@@ -411,14 +533,14 @@ namespace clock
                 #ifdef DBG_CLOCK_H
                 DEBUG << "CLOCK_H(" << id() << ") wait positive edge\n";
                 #endif
-                posedgeQueue.push(h);
+                posedgeQueue.push_back(h);
                 break;
 
             case eClockEdge::negative:
                 #ifdef DBG_CLOCK_H
                 DEBUG << "CLOCK_H(" << id() << ") wait negative edge\n";
                 #endif
-                negedgeQueue.push(h);
+                negedgeQueue.push_back(h);
                 break;
             
             default:
@@ -426,6 +548,49 @@ namespace clock
                 break;
             }
         }
+
+        /**
+         * @brief Wait for a number of clock cycles
+         * @details This function adds a coroutine handle to the cycle queue.
+         * 
+         * The coroutine is suspended once and resumed on the n-th positive
+         * edge from now, instead of being resumed on every edge in between.
+         * 
+         * @param[in] n     Number of cycles to wait, must be at least 1
+         * @param[in] h     Handle to the coroutine
+         */
+        void waitForCycles(uint64_t n, coroutine_handle<> h)
+        {
+            #ifdef DBG_CLOCK_H
+            DEBUG << "CLOCK_H(" << id() << ") wait " << n << " cycles\n";
+            #endif
+
+            assert(n > 0);
+            cycleQueue.push({_cycles + n, _cycleWaitOrder++, h});
+        }
+
+        /**
+         * @brief Wait for a signal value
+         * @details This function adds a coroutine handle to the signal queue.
+         * 
+         * After every matching edge the clock compares the signal with the value
+         * and only resumes the coroutine when they are equal.
+         * 
+         * @param[in] edge      The edge to check the signal on
+         * @param[in] signal    The signal to check
+         * @param[in] value     The value to wait for
+         * @param[in] h         Handle to the coroutine
+         */
+        template <typename T>
+        void waitForSignal(eClockEdge edge, const T& signal, T value, coroutine_handle<> h)
+        {
+            #ifdef DBG_CLOCK_H
+            DEBUG << "CLOCK_H(" << id() << ") wait for signal\n";
+            #endif
+
+            auto match = [](const void* signal, uint64_t value) { return *static_cast<const T*>(signal) == static_cast<T>(value); };
+            signalQueue.push_back({edge, &signal, static_cast<uint64_t>(value), match, h});
+        }
     };
 
     /**
@@ -474,6 +639,101 @@ namespace clock
         }
     };
 
+    /**
+     * @class cCyclesAwaitable
+     * @brief Clock cycles awaitable
+     * 
+     * @details This class is the awaitable to wait for a number of clock cycles.
+     * The coroutine is suspended once and resumed on the n-th positive edge, 
+     * which is the same as, but much cheaper than, n times waitPosEdge().
+     * Waiting for 0 cycles does not suspend.
+     * 
+     * Usage: co_await cCyclesAwaitable(pclk, 5000);
+     * 
+     */
+    class cCyclesAwaitable
+    {
+        private:
+        cClock* _clock;
+        uint64_t _cycles;
+
+        public:
+        cCyclesAwaitable(cClock* aClock, uint64_t cycles) : _clock(aClock), _cycles(cycles){};
+
+        bool await_ready()
+        {
+            return _cycles == 0;
+        }
+
+        void await_suspend(coroutine_handle<> handle)
+        {
+            _clock->waitForCycles(_cycles, handle);
+        }
+
+        void await_resume()
+        {
+
+        }
+    };
+
+    /**
+     * @class cSignalAwaitable
+     * @brief Signal awaitable
+     * 
+     * @details This class is the awaitable to wait until a signal has a value.
+     * The signal is checked by the clock after every positive (or negative) edge
+     * and the coroutine is only resumed when the signal has the value, instead of
+     * being resumed on every edge to poll the signal.
+     * 
+     * When the signal already has the value the coroutine does not suspend, which
+     * makes it a drop-in replacement for: while (signal != value) waitPosEdge(clk);
+     * 
+     * Usage: co_await waitSignal(PREADY, H, PCLK);
+     * 
+     */
+    template <typename T>
+    class cSignalAwaitable
+    {
+        private:
+        cClock* _clock;
+        const T& _signal;
+        T _value;
+        eClockEdge _edge;
+
+        public:
+        cSignalAwaitable(const T& signal, T value, cClock* aClock, eClockEdge edge) : _clock(aClock), _signal(signal), _value(value), _edge(edge){};
+
+        bool await_ready()
+        {
+            return _signal == _value;
+        }
+
+        void await_suspend(coroutine_handle<> handle)
+        {
+            _clock->waitForSignal(_edge, _signal, _value, handle);
+        }
+
+        void await_resume()
+        {
+
+        }
+    };
+
+    /**
+     * @brief Wait until a signal has a value, checked on a clock edge
+     * 
+     * @param[in] signal    The signal to check, e.g. a verilated model port
+     * @param[in] value     The value to wait for
+     * @param[in] clk       The clock to check the signal on
+     * @param[in] edge      The clock edge to check the signal on, default positive
+     * @return The awaitable
+     */
+    template <typename T, typename V>
+    cSignalAwaitable<T> waitSignal(const T& signal, V value, cClock* clk, eClockEdge edge = eClockEdge::positive)
+    {
+        return cSignalAwaitable<T>(signal, static_cast<T>(value), clk, edge);
+    }
+
 }
 }
 }
@@ -38,11 +38,10 @@
 
 #include <clock.hpp>
 
-//For vector
+//For vector, deque and priority_queue
 #include <vector>
-
-//For MAXFLOAT
-#include <limits>
+#include <deque>
+#include <queue>
 
 //For logging
 #include <log.hpp>
@@ -62,68 +61,165 @@ namespace clock
      * @brief Clock Manager Class for use in testbenches 
      * 
      * @details Manage the clock inputs of a verilated design
+     * 
+     * The clock manager is an event scheduler. Every running clock has exactly one
+     * entry in a min-heap, keyed on the absolute time of its next edge. A tick pops
+     * the clocks whose edge is due, toggles them and pushes them back with their
+     * following edge, so a tick only touches the clocks that actually toggle.
+     * 
+     * Disabled clocks are parked when their entry comes up. Once enabled again they
+     * are rescheduled one (high or low) period after the tick that notices this.
+     * 
+     * Next to clocks the clock manager holds timers, coroutines waiting for an absolute
+     * simulation time (see waitFor() and waitUntil()). These are kept in a second min-heap 
+     * and take part in the search for the next event time.
+     * 
+     * Coroutines are not resumed while the clocks are processed. Clock edges and timers
+     * add the coroutines that are ready to a run queue, which the testbench drains with
+     * resumeReady() in batches (delta cycles) between evaluations of the model.
      */
-    class cClockManager
+    class cClockManager final
     {
         private:
-            std::vector<cClock*> *_clocks;   //!< Collection holding all clocks
-            simtime_t _time;                 //!< Simulation time
-            simtime_t _precision;            //!< Simulation precision
+            /**
+             * @brief Scheduled clock event
+             * @details The order is the sequence in which clocks were added, it makes
+             * coinciding edges toggle in a deterministic order
+             */
+            struct sClockEvent
+            {
+                simtime_t time;     //!< Absolute time of the event
+                size_t    order;    //!< Order in which the clock was added
+                cClock*   clock;    //!< Clock to toggle
 
-        public:
+                bool operator>(const sClockEvent& rhs) const
+                {
+                    return (time == rhs.time) ? (order > rhs.order) : (time > rhs.time);
+                }
+            };
+
+            typedef std::priority_queue<sClockEvent, std::vector<sClockEvent>, std::greater<sClockEvent>> eventQueue_t;
 
             /**
-             * @brief Construct a new cClockManager object
+             * @brief Scheduled timer event
+             * @details The order is the sequence in which timers were started,
+             * timers that expire at the same time resume in that order
+             */
+            struct sTimerEvent
+            {
+                simtime_t time;             //!< Absolute time of the event
+                uint64_t  order;            //!< Order in which the timer was started
+                std::coroutine_handle<> h;  //!< Waiting coroutine
+
+                bool operator>(const sTimerEvent& rhs) const
+                {
+                    return (time == rhs.time) ? (order > rhs.order) : (time > rhs.time);
+                }
+            };
+
+            typedef std::priority_queue<sTimerEvent, std::vector<sTimerEvent>, std::greater<sTimerEvent>> timerQueue_t;
+
+            static std::vector<cClockManager*> _managers; //!< Live clock managers, the active one last
+
+            std::deque<cClock> _clocks;      //!< Collection holding all clocks, by value with stable addresses
+            eventQueue_t _events;            //!< Min-heap of next clock events
+            std::vector<sClockEvent> _parked;//!< Disabled clocks, not in the event queue
+            std::vector<cClock*> _toggled;   //!< Clocks toggled in the current tick
+            timerQueue_t _timers;            //!< Min-heap of timers
+            uint64_t _timerOrder;            //!< Number of timers started
+            simtime_t _time;                 //!< Simulation time
+            bool _dirty;                     //!< Model inputs changed since clearDirty()
+            std::vector<std::coroutine_handle<>> _ready;   //!< Run queue, coroutines to resume in the next batch
+            std::vector<std::coroutine_handle<>> _running; //!< Batch being resumed, swapped with the run queue
+
+            /**
+             * @brief Schedule a clock's next event
+             * @details Running clocks are pushed onto the event queue,
+             * disabled clocks are parked until they are enabled again
              * 
+             * @param[in] event The event to schedule
              */
-            cClockManager(simtime_t precision) : 
-                _precision(precision),
-                _time(0.0)
+            void schedule(const sClockEvent& event)
             {
-                //Create new collection
-                _clocks = new std::vector<cClock*>();
+                if (event.clock->_running)
+                {
+                    _events.push(event);
+                }
+                else
+                {
+                    _parked.push_back(event);
+                }
             }
 
+            /**
+             * @brief Reschedule parked clocks that are enabled again
+             * @details An enabled clock continues at its current level
+             * and toggles one high or low period from now
+             */
+            void resumeParked(void)
+            {
+                for (auto it = _parked.begin(); it != _parked.end(); )
+                {
+                    cClock* clk = it->clock;
+
+                    if (clk->_running)
+                    {
+                        clk->_nextEventTime = _time + (clk->_clk ? clk->_highPeriod : clk->_lowPeriod);
+                        _events.push({clk->_nextEventTime, it->order, clk});
+                        it = _parked.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+            }
+
+        public:
 
             /**
-             * @brief Destroy the cClockManager object
+             * @brief Construct a new cClockManager object
              * 
              */
-            virtual ~cClockManager(void)
+            cClockManager(void) : 
+                _timerOrder(0),
+                _time(0),
+                _dirty(true)
             {
-                //Remove and destroy all clocks from collection
-                for (const auto clock : *_clocks)
-                {
-                    delete clock;
-                }            
+                _managers.push_back(this);
 
-                //Destroy collection
-                delete _clocks;
-                _clocks = NULL;
+                _ready.reserve(cWaitQueueReserve);
+                _running.reserve(cWaitQueueReserve);
             }
 
             /**
-             * @brief Add a new clock as reference
+             * @brief Destroy the cClockManager object
              * 
-             * @param[in] Clock Clock object to add
              */
-            virtual void add(cClock &Clock) const
+            ~cClockManager(void)
             {
-                _clocks->push_back(&Clock);
+                std::erase(_managers, this);
             }
 
             /**
-             * @brief Add a new clock as pointer
+             * @brief Get the active clock manager
+             * @details This is the most recently constructed clock manager that
+             * still exists, timers started with waitFor(), waitUntil() and waitDelta()
+             * without a manager are added to it. With more than one clock manager, e.g. 
+             * two testbenches in the same process, pass the manager explicitly
+             * or use the testbench's own waitFor(), waitUntil() and waitDelta().
              * 
-             * @param[in] Clock Clock object to add
+             * @return Pointer to the active clock manager, nullptr when there is none
              */
-            virtual void add(cClock* Clock) const
+            static cClockManager* getActive(void)
             {
-                _clocks->push_back(Clock);
+                return _managers.empty() ? nullptr : _managers.back();
             }
 
             /**
              * @brief Add and create a new clock
+             * @details The clock is stored in the clock manager, its first 
+             * edge is scheduled relative to the current simulation time
              * 
              * @param[in] clk         Clock pin  
              * @param[in] LowPeriod   The period that the pin shall be low
@@ -131,13 +227,15 @@ namespace clock
              * @param[in] on           The clock is directly active, default = true
              * @return cClock*        Pointer to the cClock object that is created
              */
-            virtual cClock* const add(uint8_t& Clock, simtime_t LowPeriod, simtime_t HighPeriod, bool on = true) const
+            cClock* const add(uint8_t& Clock, simtime_t LowPeriod, simtime_t HighPeriod, bool on = true)
             {
-                //Create new VClock
-                cClock* clock = new cClock(Clock, _precision, LowPeriod, HighPeriod, on);
+                //Create new clock in place
+                cClock* clock = &_clocks.emplace_back(Clock, LowPeriod, HighPeriod, on);
 
-                //Add clock
-                add(clock);
+                clock->_nextEventTime += _time;
+                clock->_inputsDirty = &_dirty;
+                clock->_readyQueue = &_ready;
+                schedule({clock->_nextEventTime, _clocks.size() - 1, clock});
 
                 //Return new object
                 return clock;
@@ -151,9 +249,11 @@ namespace clock
              * @param[in] on           The clock is directly active, default = true
              * @return cClock*        Pointer to the cClock object that is created
              */
-            virtual cClock* const add(uint8_t& Clock, simtime_t Period, bool on = true) const
+            cClock* const add(uint8_t& Clock, simtime_t Period, bool on = true)
             {
-                return add(Clock, Period/2.0, Period/2.0, on);
+                //Split in integer ticks, an odd tick goes to the high period
+                simtime_t LowPeriod = Period / 2;
+                return add(Clock, LowPeriod, Period - LowPeriod, on);
             }
 
             /**
@@ -162,17 +262,29 @@ namespace clock
              * @return true     There is atleast one clock
              * @return false    No clocks
              */
-            virtual bool empty(void) const
+            bool empty(void) const
             {
-                return _clocks->empty();
+                return _clocks.empty();
             }
 
             /**
              * @brief Time manager tick function
              * @details This function is the actual time manager for all clocks
              * 
-             * It checks the periods of the clocks against the settings of each clock individually. If the 
-             * time has passed it changes the clock input.
+             * It advances the simulation time to the first scheduled event and toggles
+             * every clock that has an edge at that time. Each toggled clock is rescheduled 
+             * for its next edge, clocks that have been disabled are parked.
+             * 
+             * Coinciding edges are handled in a single tick: all clocks are toggled first,
+             * then the coroutines waiting on any of these edges are added to the run queue,
+             * in the order the clocks were added. This way the coroutines see a consistent 
+             * set of clock levels and the testbench needs only one eval() for all of them.
+             * 
+             * Timers that expire at that time are queued after the clock edge coroutines.
+             * 
+             * The coroutines are resumed by resumeReady(), not by tick().
+             * 
+             * When no clock is running and no timer is pending the time does not advance.
              * 
              * @return It returns the current passed time
              */
@@ -182,48 +294,338 @@ namespace clock
                 DEBUG << "CLOCKMANAGER_H - tick() \n";
                 #endif
 
-                //Current minimum time to next event = maximum float value
-                simtime_t minTimeToNextEvent = simtime_t::max();
+                simtime_t nextEventTime = getNextEventTime();
+
+                if (nextEventTime == simtime_t::max())
+                {
+                    return _time;
+                }
+
+                //Advance time to the next event
+                _time = nextEventTime;
 
-                //Find next event
-                for (const auto clk : *_clocks)
+                //Toggle all clocks with an edge at this time
+                while (!_events.empty() && _events.top().time == _time)
                 {
-                    simtime_t timeToNextEvent = clk->getTimeToNextEvent();
+                    sClockEvent event = _events.top();
+                    _events.pop();
 
-                    if (timeToNextEvent < minTimeToNextEvent)
+                    if (event.clock->_running)
                     {
-                        minTimeToNextEvent = timeToNextEvent;
-                    }             
+                        event.clock->toggle();
+                        event.time = event.clock->_nextEventTime;
+                        _toggled.push_back(event.clock);
+                    }
 
                     #ifdef DBG_CLOCKMANAGER_H
-                    //DEBUG << "CLOCKMANAGER_H - tick: " << clk->getTimeToNextEvent() << "," << minTimeToNextEvent << "\n";
+                    DEBUG << "CLOCKMANAGER_H - tick: " << _time << " next event " << event.time << "\n";
                     #endif
 
+                    schedule(event);
                 }
 
-                //Update all clocks
-                //Clocks automatically toggle when their time reaches 0
-                for (const auto clk : *_clocks)
+                //Clock pins are model inputs
+                if (!_toggled.empty())
                 {
-                    clk->updateTime(minTimeToNextEvent);
+                    _dirty = true;
                 }
 
-                //Store new time
-                _time += minTimeToNextEvent;
+                //Queue coroutines after all clocks have their new level
+                for (const auto clk : _toggled)
+                {
+                    clk->resumeWaiting();
+                }
+
+                _toggled.clear();
+
+                //Queue coroutines whose timer expired
+                while (!_timers.empty() && _timers.top().time == _time)
+                {
+                    _ready.push_back(_timers.top().h);
+                    _timers.pop();
+                }
 
                 return _time;
             }
 
+            /**
+             * @brief Check if coroutines are ready to be resumed
+             * 
+             * @return true when the run queue is not empty
+             */
+            bool ready(void) const
+            {
+                return !_ready.empty();
+            }
+
+            /**
+             * @brief Resume one batch of ready coroutines
+             * @details The run queue is swapped with the (empty) batch buffer and
+             * the coroutines in the batch are resumed in the order they were queued.
+             * 
+             * Coroutines queued while the batch runs, e.g. with waitDelta(), are 
+             * resumed in the next batch, after the model is evaluated again. Both
+             * buffers keep their capacity, so no memory is allocated once the number
+             * of ready coroutines is stable.
+             * 
+             * @return true when any coroutine was resumed
+             */
+            bool resumeReady(void)
+            {
+                if (_ready.empty())
+                {
+                    return false;
+                }
+
+                _running.swap(_ready);
+
+                //Resumed coroutines might drive inputs
+                _dirty = true;
+
+                for (const auto h : _running)
+                {
+                    h.resume();
+                }
+
+                _running.clear();
+
+                return true;
+            }
+
+            /**
+             * @brief Resume a coroutine in the next batch
+             * 
+             * @param[in] h     Handle to the coroutine
+             */
+            void waitDelta(std::coroutine_handle<> h)
+            {
+                _ready.push_back(h);
+            }
+
+            /**
+             * @brief Get the time of the next event
+             * @details Clocks that were enabled since the last tick are
+             * scheduled first, so the result is the time the next tick
+             * advances to.
+             * 
+             * @return The time of the next event, or simtime_t::max() when no clock is running and no timer is pending
+             */
+            simtime_t getNextEventTime(void)
+            {
+                if (!_parked.empty())
+                {
+                    resumeParked();
+                }
+
+                simtime_t clockTime = _events.empty() ? simtime_t::max() : _events.top().time;
+                simtime_t timerTime = _timers.empty() ? simtime_t::max() : _timers.top().time;
+
+                return clockTime < timerTime ? clockTime : timerTime;
+            }
+
+            /**
+             * @brief Start a timer
+             * @details The coroutine is resumed in the tick that advances to time
+             * 
+             * @param[in] time  Absolute time to resume at, must be in the future
+             * @param[in] h     Handle to the coroutine
+             */
+            void waitUntil(simtime_t time, std::coroutine_handle<> h)
+            {
+                #ifdef DBG_CLOCKMANAGER_H
+                DEBUG << "CLOCKMANAGER_H - waitUntil(" << time << ")\n";
+                #endif
+
+                assert(time > _time);
+                _timers.push({time, _timerOrder++, h});
+            }
+
+            /**
+             * @brief Mark the model inputs as changed
+             */
+            void markDirty(void)
+            {
+                _dirty = true;
+            }
+
+            /**
+             * @brief Clear the model inputs changed flag
+             * @details Called by the testbench after evaluating the model
+             */
+            void clearDirty(void)
+            {
+                _dirty = false;
+            }
+
+            /**
+             * @brief Check if model inputs changed
+             * 
+             * @return true when a clock toggled or an input was marked as changed since clearDirty()
+             */
+            bool dirty(void) const
+            {
+                return _dirty;
+            }
+
             /**
              * @brief get the current time
              * 
              * @return float 
              */
-            virtual simtime_t getTime(void) const
+            simtime_t getTime(void) const
             {
                 return _time;
             }
     };
+
+    inline std::vector<cClockManager*> cClockManager::_managers;
+
+    /**
+     * @class cTimerAwaitable
+     * @brief Timer awaitable
+     * 
+     * @details This class is the awaitable to wait for an absolute simulation time.
+     * The coroutine is resumed by the active clock manager when the time is reached,
+     * without being resumed on the clock edges in between.
+     * 
+     * A time that is not in the future does not suspend.
+     * 
+     * Usage: co_await waitFor(10_us); co_await waitUntil(t);
+     * 
+     */
+    class cTimerAwaitable
+    {
+        private:
+        cClockManager* _manager;
+        simtime_t _time;
+
+        public:
+        cTimerAwaitable(cClockManager* aManager, simtime_t time) : _manager(aManager), _time(time){};
+
+        bool await_ready()
+        {
+            return _time <= _manager->getTime();
+        }
+
+        void await_suspend(coroutine_handle<> handle)
+        {
+            _manager->waitUntil(_time, handle);
+        }
+
+        void await_resume()
+        {
+
+        }
+    };
+
+    /**
+     * @class cDeltaAwaitable
+     * @brief Delta cycle awaitable
+     * 
+     * @details This class is the awaitable to wait for the next delta cycle. The
+     * coroutine is resumed in the next batch of the active clock manager, after the
+     * model is evaluated, at the same simulation time. This allows a coroutine to
+     * drive an input and react to the outputs without waiting for a clock edge.
+     * 
+     * Usage: co_await waitDelta();
+     * 
+     */
+    class cDeltaAwaitable
+    {
+        private:
+        cClockManager* _manager;
+
+        public:
+        cDeltaAwaitable(cClockManager* aManager) : _manager(aManager){};
+
+        bool await_ready()
+        {
+            return false;
+        }
+
+        void await_suspend(coroutine_handle<> handle)
+        {
+            _manager->waitDelta(handle);
+        }
+
+        void await_resume()
+        {
+
+        }
+    };
+
+    /**
+     * @brief Wait for the next delta cycle of a clock manager
+     * 
+     * @param[in] manager   The clock manager
+     * @return The awaitable
+     */
+    inline cDeltaAwaitable waitDelta(cClockManager* manager)
+    {
+        assert(manager);
+        return cDeltaAwaitable(manager);
+    }
+
+    /**
+     * @brief Wait for the next delta cycle of the active clock manager
+     * 
+     * @return The awaitable
+     */
+    inline cDeltaAwaitable waitDelta(void)
+    {
+        assert(cClockManager::getActive() && "waitDelta() without a clock manager, construct the testbench first");
+        return waitDelta(cClockManager::getActive());
+    }
+
+    /**
+     * @brief Wait until an absolute simulation time of a clock manager
+     * 
+     * @param[in] manager   The clock manager
+     * @param[in] time      Time to resume at
+     * @return The awaitable
+     */
+    inline cTimerAwaitable waitUntil(cClockManager* manager, simtime_t time)
+    {
+        assert(manager);
+        return cTimerAwaitable(manager, time);
+    }
+
+    /**
+     * @brief Wait until an absolute simulation time of the active clock manager
+     * 
+     * @param[in] time  Time to resume at
+     * @return The awaitable
+     */
+    inline cTimerAwaitable waitUntil(simtime_t time)
+    {
+        assert(cClockManager::getActive() && "waitUntil() without a clock manager, construct the testbench first");
+        return waitUntil(cClockManager::getActive(), time);
+    }
+
+    /**
+     * @brief Wait for a simulation time duration of a clock manager
+     * 
+     * @param[in] manager   The clock manager
+     * @param[in] delay     Time to wait from now
+     * @return The awaitable
+     */
+    inline cTimerAwaitable waitFor(cClockManager* manager, simtime_t delay)
+    {
+        assert(manager);
+        return cTimerAwaitable(manager, manager->getTime() + delay);
+    }
+
+    /**
+     * @brief Wait for a simulation time duration of the active clock manager
+     * 
+     * @param[in] delay Time to wait from now
+     * @return The awaitable
+     */
+    inline cTimerAwaitable waitFor(simtime_t delay)
+    {
+        assert(cClockManager::getActive() && "waitFor() without a clock manager, construct the testbench first");
+        return waitFor(cClockManager::getActive(), delay);
+    }
 }
 }
 }
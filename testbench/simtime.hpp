@@ -40,9 +40,20 @@
 //#define DBG_SIMTIME_H
 
 #include <limits>       // std::numeric_limits
+#include <concepts>     // std::integral, std::floating_point
+#include <cstdint>
 #include <iostream>
 #include <log.hpp>
 
+/**
+ * Resolution of simtime_t as a power of ten in seconds, e.g. -12 for 1ps.
+ * Must be at least as fine as the timeprecision of the verilated context.
+ * With the default of 1ps a 64bit simtime_t covers more than 100 days.
+ */
+#ifndef SIMTIME_PRECISION
+#define SIMTIME_PRECISION -12
+#endif
+
 namespace RoaLogic
 {
 namespace testbench
@@ -50,7 +61,44 @@ namespace testbench
 namespace clock
 {
     template <typename T> class cSimtime_t;
-    typedef cSimtime_t<long double> simtime_t;
+    typedef cSimtime_t<int64_t> simtime_t;
+
+    /**
+     * @brief Compile time power of ten
+     * 
+     * @param exp       Exponent, may be negative
+     * @return 10^exp
+     */
+    constexpr long double fpow10(int exp)
+    {
+        long double result = 1.0;
+        for (; exp > 0; --exp) result *= 10.0;
+        for (; exp < 0; ++exp) result /= 10.0;
+        return result;
+    }
+
+    /**
+     * @brief Compile time integer power of ten
+     * 
+     * @param exp       Exponent, must be positive
+     * @return 10^exp
+     */
+    constexpr int64_t ipow10(int exp)
+    {
+        int64_t result = 1;
+        for (; exp > 0; --exp) result *= 10;
+        return result;
+    }
+
+    /**
+     * @brief Compile time unsigned multiply, saturates instead of wrapping
+     * 
+     * @return a*b, or the maximum value when it does not fit
+     */
+    constexpr unsigned long long umulsat(unsigned long long a, unsigned long long b)
+    {
+        return (b != 0 && a > std::numeric_limits<unsigned long long>::max() / b) ? std::numeric_limits<unsigned long long>::max() : a * b;
+    }
 
     /**
      * @class SimTime
@@ -140,24 +188,220 @@ namespace clock
             _realtime /= rhs._realtime;
             return *this;
         }
+    };
+
+    //streaming operator
+    template <typename T> 
+    inline std::ostream& operator<<(std::ostream& out, const cSimtime_t<T>& t)
+    {
+        if (t > cSimtime_t<T>::seconds_per_year  ) { return out << t.year()   << "years";   }
+        if (t > cSimtime_t<T>::seconds_per_day   ) { return out << t.day()    << "days";    }
+        if (t > cSimtime_t<T>::seconds_per_hour  ) { return out << t.hour()   << "hours";   }
+        if (t > cSimtime_t<T>::seconds_per_minute) { return out << t.minute() << "minutes"; }
+        if (t > 1.0                              ) { return out << t.s()      << "sec";     }
+        if (t > 1.0E-3                           ) { return out << t.ms()     << "ms";      }
+        if (t > 1.0E-6                           ) { return out << t.us()     << "us";      }
+        if (t > 1.0E-9                           ) { return out << t.ns()     << "ns";      }
+        if (t > 1.0E-12                          ) { return out << t.ps()     << "ps";      }
+        if (t > 1.0E-15                          ) { return out << t.fs()     << "fs";      }
+        
+        return out << t.as() << "as";
+    }
+
+
+    /**
+     * @class SimTime
+     * @author Richard Herveille
+     * @brief Fixed point Simulation Time Class for use in cClock and in cTestBench
+     *
+     * @details This specialization stores the time as a 64bit integer number of ticks,
+     * where a tick is 10^SIMTIME_PRECISION seconds. All arithmetic and comparisons
+     * are integer operations, so clocks never drift and edges that should coincide
+     * do coincide.
+     * 
+     * Constructing from a floating point value interprets the value as seconds and
+     * rounds it to the nearest tick; this keeps code like simtime_t(1.0/baudrate) working.
+     * The unit literals (_ns, _MHz, ...) are constexpr and resolve at compile time.
+     */
+    template <> class cSimtime_t<int64_t>
+    {
+        private:
+        int64_t _ticks;  //time in ticks of 10^SIMTIME_PRECISION seconds
+
+        //round to the nearest tick, saturate when out of range
+        constexpr static int64_t round(long double val)
+        {
+            if (val >= (long double)std::numeric_limits<int64_t>::max()) return std::numeric_limits<int64_t>::max();
+            if (val <= (long double)std::numeric_limits<int64_t>::min()) return std::numeric_limits<int64_t>::min();
+            return (int64_t)(val < 0 ? val - 0.5 : val + 0.5);
+        }
+
+        public:
+        typedef int64_t tick_t;
+
+        constexpr static int         precision        = SIMTIME_PRECISION;
+        constexpr static long double ticks_per_second = fpow10(-precision);
+
+        constexpr static long double seconds_per_minute = 60.0;
+        constexpr static long double minutes_per_hour   = 60.0;
+        constexpr static long double seconds_per_hour   = seconds_per_minute * minutes_per_hour;
+        constexpr static long double hours_per_day      = 24.0;
+        constexpr static long double minutes_per_day    = hours_per_day * minutes_per_hour;
+        constexpr static long double seconds_per_day    = minutes_per_day * seconds_per_minute;
+        constexpr static long double days_per_year      = 365.0;
+        constexpr static long double seconds_per_year   = days_per_year * seconds_per_day;
+        constexpr static long double seconds_per_Hz     = 1.0;
+
+        //constructors
+        constexpr cSimtime_t () : _ticks(0) {};
+        constexpr cSimtime_t (long double seconds) : _ticks(round(seconds * ticks_per_second)) {};
+
+        /**
+         * @brief Create a simtime from a number of ticks
+         */
+        constexpr static cSimtime_t fromTicks(tick_t ticks)
+        {
+            cSimtime_t t;
+            t._ticks = ticks;
+            return t;
+        }
+
+        /**
+         * @brief Create a simtime from a value in units of 10^unitExp seconds
+         * @details Uses integer arithmetic when the unit is a multiple of a tick,
+         * saturates when out of range like the floating point version
+         */
+        constexpr static cSimtime_t fromUnit(unsigned long long val, int unitExp)
+        {
+            if (unitExp < precision)
+            {
+                return fromTicks( round((long double)val / ipow10(precision - unitExp)) );
+            }
+
+            unsigned long long ticks = umulsat(val, ipow10(unitExp - precision));
+            return ticks > (unsigned long long)std::numeric_limits<tick_t>::max() ? max() : fromTicks( (tick_t)ticks );
+        }
+
+        constexpr static cSimtime_t fromUnit(long double val, int unitExp)
+        {
+            return fromTicks( round(val * fpow10(unitExp - precision)) );
+        }
+
+        /**
+         * @brief Create a simtime holding the period of a frequency in Hz
+         */
+        constexpr static cSimtime_t fromFrequency(long double hz)
+        {
+            return fromTicks( round(ticks_per_second / hz) );
+        }
+
+        constexpr static cSimtime_t max() { return fromTicks(std::numeric_limits<tick_t>::max()); };
+
+        //raw tick count
+        constexpr tick_t ticks(void) const { return _ticks; }
+
+        //convert to seconds
+        explicit operator long double() const { return s(); }
+
+        //convert to frequency
+        long double frequency(void) const { return (ticks_per_second / _ticks); }
+
+        //output formats
+        long double year   (void) const { return (s() / seconds_per_year  ); }
+        long double day    (void) const { return (s() / seconds_per_day   ); }
+        long double hour   (void) const { return (s() / seconds_per_hour  ); }
+        long double minute (void) const { return (s() / seconds_per_minute); }
+        long double s      (void) const { return (_ticks / ticks_per_second); }
+        long double ms     (void) const { return (_ticks * fpow10(precision +  3)); }
+        long double us     (void) const { return (_ticks * fpow10(precision +  6)); }
+        long double ns     (void) const { return (_ticks * fpow10(precision +  9)); }
+        long double ps     (void) const { return (_ticks * fpow10(precision + 12)); }
+        long double fs     (void) const { return (_ticks * fpow10(precision + 15)); }
+        long double as     (void) const { return (_ticks * fpow10(precision + 18)); }
+
+        long double PHz    (void) const { return ( frequency() / 1.0E15         ); }
+        long double THz    (void) const { return ( frequency() / 1.0E12         ); }
+        long double GHz    (void) const { return ( frequency() / 1.0E9          ); }
+        long double MHz    (void) const { return ( frequency() / 1.0E6          ); }
+        long double kHz    (void) const { return ( frequency() / 1.0E3          ); }
+        long double Hz     (void) const { return   frequency();                    }
+        long double mHz    (void) const { return ( frequency() * 1.0E3          ); }
+        long double uHz    (void) const { return ( frequency() * 1.0E6          ); }
+        long double nHz    (void) const { return ( frequency() * 1.0E9          ); }
+        long double pHz    (void) const { return ( frequency() * 1.0E12         ); }
+        long double fHz    (void) const { return ( frequency() * 1.0E15         ); }
+
+        //Comparison, integer only
+        constexpr auto operator<=>(const cSimtime_t&) const = default;
+        constexpr bool operator== (const cSimtime_t&) const = default;
+
+        //Overload operators
+        constexpr cSimtime_t& operator+=(const cSimtime_t& rhs)
+        {
+            _ticks += rhs._ticks;
+            return *this;
+        }
 
-        //overload <<
-        friend std::ostream& operator<<(std::ostream& out, const simtime_t& t);
+        constexpr cSimtime_t& operator-=(const cSimtime_t& rhs)
+        {
+            _ticks -= rhs._ticks;
+            return *this;
+        }
+
+        template <std::integral U>
+        constexpr cSimtime_t& operator*=(U rhs)
+        {
+            _ticks *= rhs;
+            return *this;
+        }
+
+        template <std::integral U>
+        constexpr cSimtime_t& operator/=(U rhs)
+        {
+            _ticks /= rhs;
+            return *this;
+        }
+
+        template <std::floating_point U>
+        constexpr cSimtime_t& operator*=(U rhs)
+        {
+            _ticks = round(_ticks * (long double)rhs);
+            return *this;
+        }
+
+        template <std::floating_point U>
+        constexpr cSimtime_t& operator/=(U rhs)
+        {
+            _ticks = round(_ticks / (long double)rhs);
+            return *this;
+        }
+
+        friend constexpr cSimtime_t operator+(cSimtime_t lhs, const cSimtime_t& rhs) { return lhs += rhs; }
+        friend constexpr cSimtime_t operator-(cSimtime_t lhs, const cSimtime_t& rhs) { return lhs -= rhs; }
+
+        template <typename U> requires std::is_arithmetic_v<U>
+        friend constexpr cSimtime_t operator*(cSimtime_t lhs, U rhs) { return lhs *= rhs; }
+
+        template <typename U> requires std::is_arithmetic_v<U>
+        friend constexpr cSimtime_t operator/(cSimtime_t lhs, U rhs) { return lhs /= rhs; }
+
+        //ratio of two times, truncated like std::chrono
+        friend constexpr tick_t operator/(const cSimtime_t& lhs, const cSimtime_t& rhs) { return lhs._ticks / rhs._ticks; }
     };
 
     //streaming operator
     inline std::ostream& operator<<(std::ostream& out, const simtime_t& t)
     {
-        if (t > simtime_t::seconds_per_year  ) { return out << t.year()   << "years";   }
-        if (t > simtime_t::seconds_per_day   ) { return out << t.day()    << "days";    }
-        if (t > simtime_t::seconds_per_hour  ) { return out << t.hour()   << "hours";   }
-        if (t > simtime_t::seconds_per_minute) { return out << t.minute() << "minutes"; }
-        if (t > 1.0                          ) { return out << t.s()      << "sec";     }
-        if (t > 1.0E-3                       ) { return out << t.ms()     << "ms";      }
-        if (t > 1.0E-6                       ) { return out << t.us()     << "us";      }
-        if (t > 1.0E-9                       ) { return out << t.ns()     << "ns";      }
-        if (t > 1.0E-12                      ) { return out << t.ps()     << "ps";      }
-        if (t > 1.0E-15                      ) { return out << t.fs()     << "fs";      }
+        if (t > simtime_t(simtime_t::seconds_per_year  )) { return out << t.year()   << "years";   }
+        if (t > simtime_t(simtime_t::seconds_per_day   )) { return out << t.day()    << "days";    }
+        if (t > simtime_t(simtime_t::seconds_per_hour  )) { return out << t.hour()   << "hours";   }
+        if (t > simtime_t(simtime_t::seconds_per_minute)) { return out << t.minute() << "minutes"; }
+        if (t > simtime_t::fromUnit(1ULL,   0)          ) { return out << t.s()      << "sec";     }
+        if (t > simtime_t::fromUnit(1ULL,  -3)          ) { return out << t.ms()     << "ms";      }
+        if (t > simtime_t::fromUnit(1ULL,  -6)          ) { return out << t.us()     << "us";      }
+        if (t > simtime_t::fromUnit(1ULL,  -9)          ) { return out << t.ns()     << "ns";      }
+        if (t > simtime_t::fromUnit(1ULL, -12)          ) { return out << t.ps()     << "ps";      }
+        if (t > simtime_t::fromUnit(1ULL, -15)          ) { return out << t.fs()     << "fs";      }
         
         return out << t.as() << "as";
     }
@@ -168,63 +412,63 @@ namespace clock
     {
         /* cSimtime_t
          */
-        inline simtime_t operator""_yr     (long double        val) { return simtime_t(val * simtime_t::seconds_per_year  ); }
-        inline simtime_t operator""_year   (long double        val) { return simtime_t(val * simtime_t::seconds_per_year  ); }
-        inline simtime_t operator""_d      (long double        val) { return simtime_t(val * simtime_t::seconds_per_day   ); }
-        inline simtime_t operator""_day    (long double        val) { return simtime_t(val * simtime_t::seconds_per_day   ); }
-        inline simtime_t operator""_h      (long double        val) { return simtime_t(val * simtime_t::seconds_per_hour  ); }
-        inline simtime_t operator""_hr     (long double        val) { return simtime_t(val * simtime_t::seconds_per_hour  ); }
-        inline simtime_t operator""_hour   (long double        val) { return simtime_t(val * simtime_t::seconds_per_hour  ); }
-        inline simtime_t operator""_min    (long double        val) { return simtime_t(val * simtime_t::seconds_per_minute); }
-        inline simtime_t operator""_minutes(long double        val) { return simtime_t(val * simtime_t::seconds_per_minute); }
-        inline simtime_t operator""_s      (long double        val) { return simtime_t(val * 1.0                          ); }
-        inline simtime_t operator""_ms     (long double        val) { return simtime_t(val / 1.0E3                        ); }
-        inline simtime_t operator""_us     (long double        val) { return simtime_t(val / 1.0E6                        ); }
-        inline simtime_t operator""_ns     (long double        val) { return simtime_t(val / 1.0E9                        ); }
-        inline simtime_t operator""_ps     (long double        val) { return simtime_t(val / 1.0E12                       ); }
-        inline simtime_t operator""_fs     (long double        val) { return simtime_t(val / 1.0E15                       ); }
-        inline simtime_t operator""_as     (long double        val) { return simtime_t(val / 1.0E18                       ); }
-
-        inline simtime_t operator""_yr     (unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_year  ); }
-        inline simtime_t operator""_year   (unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_year  ); }
-        inline simtime_t operator""_d      (unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_day   ); }
-        inline simtime_t operator""_day    (unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_day   ); }
-        inline simtime_t operator""_h      (unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_hour  ); }
-        inline simtime_t operator""_hr     (unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_hour  ); }
-        inline simtime_t operator""_hour   (unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_hour  ); }
-        inline simtime_t operator""_min    (unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_minute); }
-        inline simtime_t operator""_minutes(unsigned long long val) { return simtime_t( (long double)val * simtime_t::seconds_per_minute); }
-        inline simtime_t operator""_s      (unsigned long long val) { return simtime_t( (long double)val * 1.0                          ); }
-        inline simtime_t operator""_ms     (unsigned long long val) { return simtime_t( (long double)val / 1.0E3                        ); }
-        inline simtime_t operator""_us     (unsigned long long val) { return simtime_t( (long double)val / 1.0E6                        ); }
-        inline simtime_t operator""_ns     (unsigned long long val) { return simtime_t( (long double)val / 1.0E9                        ); }
-        inline simtime_t operator""_ps     (unsigned long long val) { return simtime_t( (long double)val / 1.0E12                       ); }
-        inline simtime_t operator""_fs     (unsigned long long val) { return simtime_t( (long double)val / 1.0E15                       ); }
-        inline simtime_t operator""_as     (unsigned long long val) { return simtime_t( (long double)val / 1.0E18                       ); }
-
-        inline simtime_t operator""_PHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E15)); }
-        inline simtime_t operator""_THz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E12)); }
-        inline simtime_t operator""_GHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E9 )); }
-        inline simtime_t operator""_MHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E6 )); }
-        inline simtime_t operator""_KHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E3 )); }
-        inline simtime_t operator""_Hz     (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0   )); }
-        inline simtime_t operator""_mHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E3 )); }
-        inline simtime_t operator""_uHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E6 )); }
-        inline simtime_t operator""_nHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E9 )); }
-        inline simtime_t operator""_pHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E12)); }
-        inline simtime_t operator""_fHz    (long double        val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E15)); }
-
-        inline simtime_t operator""_PHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E15)); }
-        inline simtime_t operator""_THz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E12)); }
-        inline simtime_t operator""_GHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E9 )); }
-        inline simtime_t operator""_MHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E6 )); }
-        inline simtime_t operator""_KHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0E3 )); }
-        inline simtime_t operator""_Hz     (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val * 1.0   )); }
-        inline simtime_t operator""_mHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E3 )); }
-        inline simtime_t operator""_uHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E6 )); }
-        inline simtime_t operator""_nHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E9 )); }
-        inline simtime_t operator""_pHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E12)); }
-        inline simtime_t operator""_fHz    (unsigned long long val) { return simtime_t(simtime_t::seconds_per_Hz / (val / 1.0E15)); }
+        constexpr simtime_t operator""_yr     (long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_year  ,   0); }
+        constexpr simtime_t operator""_year   (long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_year  ,   0); }
+        constexpr simtime_t operator""_d      (long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_day   ,   0); }
+        constexpr simtime_t operator""_day    (long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_day   ,   0); }
+        constexpr simtime_t operator""_h      (long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_hour  ,   0); }
+        constexpr simtime_t operator""_hr     (long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_hour  ,   0); }
+        constexpr simtime_t operator""_hour   (long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_hour  ,   0); }
+        constexpr simtime_t operator""_min    (long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_minute,   0); }
+        constexpr simtime_t operator""_minutes(long double        val) { return simtime_t::fromUnit(val * simtime_t::seconds_per_minute,   0); }
+        constexpr simtime_t operator""_s      (long double        val) { return simtime_t::fromUnit(val                                ,   0); }
+        constexpr simtime_t operator""_ms     (long double        val) { return simtime_t::fromUnit(val                                ,  -3); }
+        constexpr simtime_t operator""_us     (long double        val) { return simtime_t::fromUnit(val                                ,  -6); }
+        constexpr simtime_t operator""_ns     (long double        val) { return simtime_t::fromUnit(val                                ,  -9); }
+        constexpr simtime_t operator""_ps     (long double        val) { return simtime_t::fromUnit(val                                , -12); }
+        constexpr simtime_t operator""_fs     (long double        val) { return simtime_t::fromUnit(val                                , -15); }
+        constexpr simtime_t operator""_as     (long double        val) { return simtime_t::fromUnit(val                                , -18); }
+
+        constexpr simtime_t operator""_yr     (unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_year)  ,   0); }
+        constexpr simtime_t operator""_year   (unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_year)  ,   0); }
+        constexpr simtime_t operator""_d      (unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_day)   ,   0); }
+        constexpr simtime_t operator""_day    (unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_day)   ,   0); }
+        constexpr simtime_t operator""_h      (unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_hour)  ,   0); }
+        constexpr simtime_t operator""_hr     (unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_hour)  ,   0); }
+        constexpr simtime_t operator""_hour   (unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_hour)  ,   0); }
+        constexpr simtime_t operator""_min    (unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_minute),   0); }
+        constexpr simtime_t operator""_minutes(unsigned long long val) { return simtime_t::fromUnit(umulsat(val, (unsigned long long)simtime_t::seconds_per_minute),   0); }
+        constexpr simtime_t operator""_s      (unsigned long long val) { return simtime_t::fromUnit(val                                                            ,   0); }
+        constexpr simtime_t operator""_ms     (unsigned long long val) { return simtime_t::fromUnit(val                                                            ,  -3); }
+        constexpr simtime_t operator""_us     (unsigned long long val) { return simtime_t::fromUnit(val                                                            ,  -6); }
+        constexpr simtime_t operator""_ns     (unsigned long long val) { return simtime_t::fromUnit(val                                                            ,  -9); }
+        constexpr simtime_t operator""_ps     (unsigned long long val) { return simtime_t::fromUnit(val                                                            , -12); }
+        constexpr simtime_t operator""_fs     (unsigned long long val) { return simtime_t::fromUnit(val                                                            , -15); }
+        constexpr simtime_t operator""_as     (unsigned long long val) { return simtime_t::fromUnit(val                                                            , -18); }
+
+        constexpr simtime_t operator""_PHz    (long double        val) { return simtime_t::fromFrequency(val * 1.0E15); }
+        constexpr simtime_t operator""_THz    (long double        val) { return simtime_t::fromFrequency(val * 1.0E12); }
+        constexpr simtime_t operator""_GHz    (long double        val) { return simtime_t::fromFrequency(val * 1.0E9 ); }
+        constexpr simtime_t operator""_MHz    (long double        val) { return simtime_t::fromFrequency(val * 1.0E6 ); }
+        constexpr simtime_t operator""_KHz    (long double        val) { return simtime_t::fromFrequency(val * 1.0E3 ); }
+        constexpr simtime_t operator""_Hz     (long double        val) { return simtime_t::fromFrequency(val * 1.0   ); }
+        constexpr simtime_t operator""_mHz    (long double        val) { return simtime_t::fromFrequency(val / 1.0E3 ); }
+        constexpr simtime_t operator""_uHz    (long double        val) { return simtime_t::fromFrequency(val / 1.0E6 ); }
+        constexpr simtime_t operator""_nHz    (long double        val) { return simtime_t::fromFrequency(val / 1.0E9 ); }
+        constexpr simtime_t operator""_pHz    (long double        val) { return simtime_t::fromFrequency(val / 1.0E12); }
+        constexpr simtime_t operator""_fHz    (long double        val) { return simtime_t::fromFrequency(val / 1.0E15); }
+
+        constexpr simtime_t operator""_PHz    (unsigned long long val) { return simtime_t::fromFrequency(val * 1.0E15); }
+        constexpr simtime_t operator""_THz    (unsigned long long val) { return simtime_t::fromFrequency(val * 1.0E12); }
+        constexpr simtime_t operator""_GHz    (unsigned long long val) { return simtime_t::fromFrequency(val * 1.0E9 ); }
+        constexpr simtime_t operator""_MHz    (unsigned long long val) { return simtime_t::fromFrequency(val * 1.0E6 ); }
+        constexpr simtime_t operator""_KHz    (unsigned long long val) { return simtime_t::fromFrequency(val * 1.0E3 ); }
+        constexpr simtime_t operator""_Hz     (unsigned long long val) { return simtime_t::fromFrequency(val * 1.0   ); }
+        constexpr simtime_t operator""_mHz    (unsigned long long val) { return simtime_t::fromFrequency(val / 1.0E3 ); }
+        constexpr simtime_t operator""_uHz    (unsigned long long val) { return simtime_t::fromFrequency(val / 1.0E6 ); }
+        constexpr simtime_t operator""_nHz    (unsigned long long val) { return simtime_t::fromFrequency(val / 1.0E9 ); }
+        constexpr simtime_t operator""_pHz    (unsigned long long val) { return simtime_t::fromFrequency(val / 1.0E12); }
+        constexpr simtime_t operator""_fHz    (unsigned long long val) { return simtime_t::fromFrequency(val / 1.0E15); }
     }
 
 }
@@ -38,7 +38,19 @@
 
 #include <coroutine>
 #include <cassert>
+#include <array>
+#include <exception>
+#include <stdexcept>
+#include <utility>
 #include <clock.hpp>
+#include <framepool.hpp>
+
+/**
+ * Coroutine frames are allocated from the per-thread frame pool.
+ * Define NO_COROUTINE_FRAME_POOL to use the global allocator instead,
+ * e.g. to compare performance.
+ */
+//#define NO_COROUTINE_FRAME_POOL
 
 namespace RoaLogic
 {
@@ -48,6 +60,71 @@ namespace tasks
 {
     using namespace std;
 
+    /**
+     * @struct  sPooledPromise
+     * @brief   Base of the promise types, allocates coroutine frames from the frame pool
+     * 
+     * @details Every call of a coroutine function allocates a frame.
+     * The frame is taken from the frame pool of the calling thread,
+     * so frames of finished transactions are reused.
+     */
+    struct sPooledPromise
+    {
+#ifndef NO_COROUTINE_FRAME_POOL
+        /**
+         * @brief Allocate the coroutine frame
+         * 
+         * @param size  Size of the coroutine frame
+         * @return void* Pointer to the frame
+         */
+        static void* operator new(size_t size)
+        {
+            return common::cFramePool::allocateFrame(size);
+        }
+
+        /**
+         * @brief Release the coroutine frame
+         * @details The frame is returned to the frame pool of the calling thread
+         * 
+         * @param ptr   Pointer to the frame
+         * @param size  Size of the coroutine frame
+         */
+        static void operator delete(void* ptr, size_t size) noexcept
+        {
+            common::cFramePool::releaseFrame(ptr, size);
+        }
+#endif
+    };
+
+    /**
+     * @struct  sJoinState
+     * @brief   State of a whenAll/whenAny join
+     * 
+     * @details The joined coroutines point to the join state. Each coroutine that
+     * finishes decrements the remaining count; the one that decrements it to zero
+     * resumes the coroutine waiting for the join.
+     */
+    struct sJoinState
+    {
+        coroutine_handle<> waitingCoroutine;  //!< Coroutine waiting for the join
+        size_t remaining;                     //!< Number of coroutines to finish before resuming
+
+        /**
+         * @brief A joined coroutine finished
+         * 
+         * @return The coroutine to transfer to
+         */
+        coroutine_handle<> arrive() noexcept
+        {
+            if (remaining > 0 && --remaining == 0)
+            {
+                return waitingCoroutine;
+            }
+
+            return std::noop_coroutine();
+        }
+    };
+
     /**
      * @struct  cCoRoutineHandler
      * @author  Richard Herveille, Bjorn Schouteten
@@ -64,11 +141,12 @@ namespace tasks
         using handle_t = coroutine_handle<promise_type>;
 
         //MUST include nested object type promise_type
-        struct promise_type
+        struct promise_type : sPooledPromise
         {
             T _myValue;                     //!< This variable is accessible from the coroutine function
             std::exception_ptr _exception;  //!< Store exception pointer
             coroutine_handle<> waitingCoroutine;
+            sJoinState* joinState = nullptr;  //!< Join of whenAll/whenAny waiting for this coroutine
 
             /**
              * @brief Get the return object
@@ -122,6 +200,9 @@ namespace tasks
              * For testbenches we will keep the state, so that we can get the result of a coroutine 
              * at the end.
              * 
+             * When the coroutine is part of a whenAll/whenAny join, the join is notified
+             * and the coroutine waiting for the join is resumed once the join completes.
+             * 
              * @return auto
              */
             auto final_suspend() noexcept 
@@ -129,16 +210,22 @@ namespace tasks
                 struct awaiter
                 {
                     coroutine_handle<> waitingCoroutine;
+                    sJoinState* joinState;
                     bool await_ready() const noexcept { return false;}
                     void await_resume() const noexcept {}
 
                     coroutine_handle<> await_suspend(coroutine_handle<promise_type> h) const noexcept
                     {
+                        if (joinState)
+                        {
+                            return joinState->arrive();
+                        }
+
                         return waitingCoroutine ? waitingCoroutine : std::noop_coroutine();
                     }
                 };
                 
-                return awaiter{waitingCoroutine}; 
+                return awaiter{waitingCoroutine, joinState}; 
             }
 
             /**
@@ -312,6 +399,380 @@ namespace tasks
             return std::move(_h.promise()._myValue);
         }
     };
+
+
+    /**
+     * @class   cJoinAwaitable
+     * @author  Richard Herveille
+     * @brief   Awaitable for whenAll and whenAny
+     * 
+     * @details The joined coroutines are already running, each waiting on its own
+     * clock edges, so they progress in the same simulation cycles. The awaiting
+     * coroutine is suspended once and resumed by the coroutine that completes the
+     * join, instead of waiting on each of them in turn.
+     * 
+     * @tparam N    Number of joined coroutines
+     */
+    template <size_t N>
+    class cJoinAwaitable
+    {
+        private:
+        std::array<coroutine_handle<>, N> _handles;  //!< Joined coroutines
+        std::array<sJoinState**, N>       _joins;    //!< Join pointers in the promises of the joined coroutines
+        bool                              _any;      //!< Resume when any, instead of all, coroutines finished
+        sJoinState                        _state;    //!< Join state
+
+        public:
+        cJoinAwaitable(std::array<coroutine_handle<>, N> handles, std::array<sJoinState**, N> joins, bool any) :
+            _handles(handles), _joins(joins), _any(any), _state{} {};
+
+        /**
+         * @brief Check if the join already completed
+         * 
+         * @return true when all (whenAll) or any (whenAny) of the coroutines finished
+         */
+        bool await_ready() const
+        {
+            size_t done = 0;
+            for (const auto h : _handles)
+            {
+                done += h.done();
+            }
+
+            return _any ? (done > 0 || N == 0) : (done == N);
+        }
+
+        /**
+         * @brief Register the join with the coroutines that are still running
+         * 
+         * @param h     The coroutine handle which calls the co_await
+         */
+        void await_suspend(coroutine_handle<> h)
+        {
+            _state.waitingCoroutine = h;
+            _state.remaining = 0;
+
+            for (size_t i = 0; i < N; i++)
+            {
+                if (!_handles[i].done())
+                {
+                    *_joins[i] = &_state;
+                    _state.remaining++;
+                }
+            }
+
+            if (_any)
+            {
+                _state.remaining = 1;
+            }
+        }
+
+        /**
+         * @brief Unregister the join from the coroutines
+         * @details With whenAny the other coroutines keep running, they must
+         * no longer notify the join when they finish.
+         * 
+         * @return The index of the first coroutine that finished
+         */
+        size_t await_resume()
+        {
+            for (auto join : _joins)
+            {
+                *join = nullptr;
+            }
+
+            for (size_t i = 0; i < N; i++)
+            {
+                if (_handles[i].done())
+                {
+                    return i;
+                }
+            }
+
+            return N;
+        }
+    };
+
+    /**
+     * @brief Wait until all coroutines finished
+     * @details The coroutines run concurrently, e.g. several bus masters and monitors.
+     * The results are retrieved with getValue() of each coroutine.
+     * 
+     * Usage: auto wr = bus.write(...); auto rx = uart.receiveByte();
+     *        co_await whenAll(wr, rx);
+     * 
+     * @param[in] tasks The coroutines to wait for
+     * @return The awaitable
+     */
+    template <typename... Ts>
+    cJoinAwaitable<sizeof...(Ts)> whenAll(sCoRoutineHandler<Ts>&... tasks)
+    {
+        return cJoinAwaitable<sizeof...(Ts)>({tasks._h...}, {&tasks._h.promise().joinState...}, false);
+    }
+
+    /**
+     * @brief Wait until any of the coroutines finished
+     * @details The other coroutines keep running.
+     * 
+     * Usage: size_t first = co_await whenAny(rx, timeout);
+     * 
+     * @param[in] tasks The coroutines to wait for
+     * @return The awaitable, co_await returns the index of the first finished coroutine
+     */
+    template <typename... Ts>
+    cJoinAwaitable<sizeof...(Ts)> whenAny(sCoRoutineHandler<Ts>&... tasks)
+    {
+        return cJoinAwaitable<sizeof...(Ts)>({tasks._h...}, {&tasks._h.promise().joinState...}, true);
+    }
+
+
+    template <typename T> struct sTask;
+
+    /**
+     * @struct  sTaskPromiseBase
+     * @brief   Common part of the sTask promise types
+     * 
+     * @details The task is started lazily: initial_suspend always suspends and
+     * the task only runs when it is awaited. When the task finishes, final_suspend
+     * transfers control directly to the awaiting coroutine (symmetric transfer),
+     * so a chain of tasks (test -> driver -> bus) neither grows the stack nor 
+     * needs an extra resume from the clock.
+     */
+    struct sTaskPromiseBase : sPooledPromise
+    {
+        std::exception_ptr _exception;        //!< Store exception pointer
+        coroutine_handle<> waitingCoroutine;  //!< Coroutine awaiting this task
+
+        /**
+         * @brief Initial suspend
+         * @details The task does not run until it is awaited
+         * 
+         * @return suspend_always
+         */
+        suspend_always initial_suspend() noexcept { return {}; }
+
+        /**
+         * @brief final suspend
+         * @details The task keeps its state, so the awaiting coroutine can 
+         * retrieve the result, and transfers to the awaiting coroutine.
+         * When nothing awaits the task control returns to whoever resumed it.
+         * 
+         * @return auto
+         */
+        auto final_suspend() noexcept
+        {
+            struct awaiter
+            {
+                coroutine_handle<> waitingCoroutine;
+                bool await_ready() const noexcept { return false; }
+                void await_resume() const noexcept {}
+
+                coroutine_handle<> await_suspend(coroutine_handle<>) const noexcept
+                {
+                    return waitingCoroutine ? waitingCoroutine : std::noop_coroutine();
+                }
+            };
+
+            return awaiter{waitingCoroutine};
+        }
+
+        /**
+         * @brief unhandled exception
+         * @details The exception is stored and rethrown in the awaiting coroutine
+         */
+        void unhandled_exception()
+        {
+            _exception = std::current_exception();
+        }
+
+        /**
+         * @brief Rethrow the stored exception, if any
+         */
+        void rethrow() const
+        {
+            if (_exception)
+            {
+                std::rethrow_exception(_exception);
+            }
+        }
+    };
+
+    /**
+     * @struct  sTaskPromise
+     * @brief   Promise type of a task returning a value
+     */
+    template <typename T>
+    struct sTaskPromise : sTaskPromiseBase
+    {
+        T _myValue;  //!< The value passed to co_return
+
+        sTask<T> get_return_object();
+
+        void return_value(T value)
+        {
+            _myValue = std::move(value);
+        }
+
+        T result()
+        {
+            rethrow();
+            return std::move(_myValue);
+        }
+    };
+
+    /**
+     * @struct  sTaskPromise
+     * @brief   Promise type of a task without a result
+     */
+    template <>
+    struct sTaskPromise<void> : sTaskPromiseBase
+    {
+        sTask<void> get_return_object();
+
+        void return_void() {}
+
+        void result()
+        {
+            rethrow();
+        }
+    };
+
+    /**
+     * @struct  sTask
+     * @author  Richard Herveille
+     * @brief   Lazily started task
+     * 
+     * @details Alternative for sCoRoutineHandler for coroutines that are always
+     * awaited, such as drivers and bus transactions called from a test.
+     * 
+     * Where sCoRoutineHandler runs eagerly up to its first wait, sTask does not run
+     * until it is awaited. co_await then transfers directly to the task and, when 
+     * the task finishes, directly back to the awaiting coroutine. The result of
+     * co_await is the value passed to co_return; T may be void.
+     * 
+     * Usage: sTask<bool> write(...) { ...; co_return true; }
+     *        bool ok = co_await write(...);
+     * 
+     * A task that is never awaited can be started with resume().
+     * 
+     * @attention GCC only turns symmetric transfer into a tail call when 
+     * optimizing, unoptimized builds still grow the stack in long synchronous chains.
+     */
+    template <typename T = void>
+    struct sTask
+    {
+        using promise_type = sTaskPromise<T>;
+        using handle_t = coroutine_handle<promise_type>;
+
+        handle_t _h; //!< Handle to coroutine
+
+        /**
+         * @brief Construct a new task
+         * 
+         * @param h     Handle to the coroutine
+         */
+        explicit sTask(handle_t h) : _h(h) {};
+
+        sTask(const sTask&) = delete;
+        sTask& operator=(const sTask&) = delete;
+
+        sTask(sTask&& other) noexcept : _h(std::exchange(other._h, nullptr)) {};
+
+        sTask& operator=(sTask&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (_h)
+                {
+                    _h.destroy();
+                }
+                _h = std::exchange(other._h, nullptr);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Destroy the task and its coroutine
+         */
+        ~sTask()
+        {
+            if (_h)
+            {
+                _h.destroy();
+            }
+        }
+
+        /**
+         * @brief Check if the task is done
+         * 
+         * @return true when the task has finished
+         */
+        explicit operator bool() const
+        {
+            return _h && _h.done();
+        }
+
+        /**
+         * @brief Start or resume a task that is not awaited
+         */
+        void resume()
+        {
+            _h.resume();
+        }
+
+        /**
+         * @brief The await ready function for the awaitable type
+         * @details An empty task, default constructed or moved from, does not
+         * suspend, await_resume() throws
+         * 
+         * @return true when the task already finished or is empty
+         */
+        bool await_ready() const noexcept
+        {
+            return !_h || _h.done();
+        }
+
+        /**
+         * @brief The await suspend function for the awaitable type
+         * @details Stores the awaiting coroutine and transfers to the task
+         * 
+         * @param h     The coroutine handle which calls the co_await
+         * @return The task to resume
+         */
+        coroutine_handle<> await_suspend(coroutine_handle<> h) noexcept
+        {
+            _h.promise().waitingCoroutine = h;
+            return _h;
+        }
+
+        /**
+         * @brief The await resume function for the awaitable type
+         * @details Rethrows an exception of the task, throws std::logic_error
+         * when the task is empty
+         * 
+         * @return The value passed to co_return
+         */
+        T await_resume()
+        {
+            if (!_h)
+            {
+                throw std::logic_error("co_await on an empty sTask");
+            }
+
+            return _h.promise().result();
+        }
+    };
+
+    template <typename T>
+    sTask<T> sTaskPromise<T>::get_return_object()
+    {
+        return sTask<T>{coroutine_handle<sTaskPromise<T>>::from_promise(*this)};
+    }
+
+    inline sTask<void> sTaskPromise<void>::get_return_object()
+    {
+        return sTask<void>{coroutine_handle<sTaskPromise<void>>::from_promise(*this)};
+    }
 }
 }
 }
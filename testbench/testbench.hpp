@@ -38,14 +38,30 @@
 
 //For Verilator methods
 #include <verilated.h>
-#include <verilated_vcd_c.h>
+
+//Trace file backends
+#include "trace.hpp"
 
 //Clock Manager
 #include "clockmanager.hpp"
 
+//Simulation time interface
+#include "timeinterface.hpp"
+
 //Assertions
 #include <cassert>
 
+//For std::predicate
+#include <concepts>
+
+//For std::unique_ptr
+#include <memory>
+
+//For trace file chunks and scopes
+#include <functional>
+#include <string>
+#include <vector>
+
 //For logging
 #include "log.hpp"
 #include "tasks.hpp"
@@ -58,12 +74,6 @@ namespace testbench
 {
     using namespace clock;
 
-    class cTimeInterface
-    {
-        public:
-        virtual simtime_t getTime() = 0;
-    };
-
     /**
      * @class cTestBench
      * @author Richard Herveille, Bjorn Schouteten
@@ -83,15 +93,212 @@ namespace testbench
     {
         private:
             VerilatedContext*  _context;     //!< Verilator Context
-            VerilatedVcdC*     _trace;       //!< Verilator Trace instance 
+            std::unique_ptr<cTraceFile> _trace; //!< Trace file
+            eTraceFormat       _traceFormat; //!< Format of the trace file
+            #if TRACE_HAS_VCD
+            cTraceRecorder*    _recorder = nullptr; //!< Flight recorder, owned by _trace
+            #endif
             cClockManager*     _clkMgr;      //<! Clock Manager
             bool               _traceActive; //!< Boolean to store if the trace is active or not
             bool               _finished;    //!< Bool to check if the testbench has finished
             simtime_t          _timeprecision = 0; //!< Time precision of our simulation
+            bool               _evalTracking;  //!< Only eval() the model when inputs changed
+            mutable uint64_t   _evalCount;     //!< Number of model evaluations
+            mutable uint64_t   _evalSaved;     //!< Number of model evaluations skipped by eval tracking
+            simtime_t          _traceStart;    //!< Start of the trace window
+            simtime_t          _traceStop;     //!< End of the trace window
+            const cClock*      _traceClock;    //!< Clock counting the cycles to trace, nullptr when not counting
+            uint64_t           _traceStopCycle;//!< Cycle count of _traceClock to stop tracing at
+            simtime_t          _traceSplitTime;  //!< Simulation time per trace file, 0 when not splitting on time
+            uint64_t           _traceSplitBytes; //!< Size of a trace file, 0 when not splitting on size
+            cSplitTraceFile::chunkHandler_t _traceChunkHandler; //!< Called with each closed trace file
+            int                _traceDepth;      //!< Number of hierarchy levels to trace
+            std::vector<std::string> _traceScopes;   //!< Scopes to trace, empty for all
+            std::vector<std::string> _traceExcludes; //!< Scopes not to trace
+
+            /**
+             * @brief Get the number of hierarchy levels to trace
+             * 
+             * @return The trace depth, cTraceAllLevels when the depth is not limited
+             */
+            int traceLevels(void) const
+            {
+                return _traceDepth > 0 ? _traceDepth : cTraceAllLevels;
+            }
+
+            /**
+             * @brief Limit the new trace to the trace depth and the selected scopes
+             * @details Verilator 5 ignores the levels registered with the model, the
+             * depth is applied with dumpvars(). Older versions only apply the levels
+             * registered with the model, which can not be counted from a scope.
+             * Fails when the scopes cannot be applied, see traceScopes().
+             * 
+             * @return false when the trace cannot be limited
+             */
+            bool limitTrace(void)
+            {
+                if (!_traceExcludes.empty())
+                {
+                    ERROR << "Cannot exclude trace scopes at runtime, use the verilator tracing_off metacomment\n";
+                    return false;
+                }
+
+                if (_traceScopes.empty())
+                {
+                    if (traceLevels() != cTraceAllLevels)
+                    {
+                        _trace->dumpvars(traceLevels(), "");
+                    }
+
+                    return true;
+                }
+
+                for (const auto& scope : _traceScopes)
+                {
+                    if (!_trace->dumpvars(traceLevels(), scope))
+                    {
+                        ERROR << "Tracing scopes needs Verilator 5\n";
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            /**
+             * @brief Check if the current step is traced
+             * 
+             * @return true when the time is in the trace window and the cycle count is not reached
+             */
+            bool tracing(void) const
+            {
+                simtime_t time = _clkMgr->getTime();
+
+                if (_traceClock && _traceClock->getCycleCount() >= _traceStopCycle)
+                {
+                    return false;
+                }
+
+                return time >= _traceStart && time < _traceStop;
+            }
+
+            /**
+             * @brief Evaluate the model
+             * @details When eval tracking is enabled the evaluation is skipped
+             * if no clock toggled and no inputs were marked as changed since 
+             * the previous evaluation.
+             */
+            void eval(void) const
+            {
+                if (!_evalTracking || _clkMgr->dirty())
+                {
+                    _core->eval();
+                    _clkMgr->clearDirty();
+                    _evalCount++;
+                }
+                else
+                {
+                    _evalSaved++;
+                }
+            }
 
         protected:
             VM*                _core;     //!< Verilator Model to test
 
+            /**
+             * @brief Advance the testbench by one clock manager step
+             * @details Whether the trace is dumped is a template argument, so 
+             * the run loops check it once instead of every step.
+             * 
+             * @tparam traceOn  Dump the trace in this step
+             */
+            template <bool traceOn> 
+            inline void step(void) const
+            {
+                /*
+                    * This is the correct order
+                    * 1. eval design (this causes all @posedge to trigger)
+                    * 2. trace->dump (previously evaluated values)
+                    * 3. toggle clock and update time
+                    *    this queues any waiting routines
+                    * 4. resume the queued routines
+                    * 5. eval design (this causes all @posedge to trigger)
+                    * 6. repeat 4 and 5 for routines queued in 4 (delta cycles)
+                    */
+                //eval logic
+                eval();
+
+                //dump trace
+                if constexpr (traceOn)
+                {
+                    if (tracing())
+                    {
+                        //Both are integer ticks, convert to the trace's timeprecision
+                        _trace->dump( (vluint64_t)(_clkMgr->getTime().ticks() / _timeprecision.ticks()) );
+                    }
+                }
+
+                //tick() clocks, resume waiting routines and eval logic
+                _clkMgr->tick();
+
+                do
+                {
+                    _clkMgr->resumeReady();
+                    eval();
+                } while (_clkMgr->ready());
+            }
+
+            /**
+             * @brief Run steps until done() returns true
+             * @details The loop stops early when the simulation finished or
+             * when no clock is running anymore. 
+             * 
+             * The finish check uses the base class conditions (finish() and $finish),
+             * overrides of tick() and finished() are not called.
+             * 
+             * @param[in] done  Condition to stop the loop, checked before every step
+             * @return true when done() returned true
+             */
+            template <bool traceOn, typename D>
+            bool run(D done)
+            {
+                while (!done())
+                {
+                    if (_finished || _context->gotFinish() || _clkMgr->getNextEventTime() == simtime_t::max())
+                    {
+                        return false;
+                    }
+
+                    step<traceOn>();
+                }
+
+                return true;
+            }
+
+            /**
+             * @brief Run steps until done() returns true
+             * @details Selects the trace or no-trace loop once for the whole run.
+             * A trace opened or closed while running takes effect in the next run.
+             * 
+             * @param[in] done  Condition to stop the loop
+             * @return true when done() returned true
+             */
+            template <typename D>
+            bool runLoop(D done)
+            {
+                //There should be at least 1 clock
+                assert (!_clkMgr->empty());
+
+                if (_traceActive && _trace)
+                {
+                    return run<true>(done);
+                }
+                else
+                {
+                    return run<false>(done);
+                }
+            }
+
             /**
              * @brief tick the testbench clocks
              * 
@@ -107,28 +314,56 @@ namespace testbench
                 //There should be at least 1 clock
                 assert (!_clkMgr->empty());
 
-                /*
-                    * This is the correct order
-                    * 1. eval design (this causes all @posedge to trigger)
-                    * 2. trace->dump (previously evaluated values)
-                    * 3. toggle clock and update time
-                    *    this resumes any waiting routines
-                    * 4. eval design (this causes all @posedge to trigger)
-                    */
-                //eval logic
-                _core->eval();
-
-                //dump trace
                 if (_traceActive && _trace)
                 {
-                    simtime_t time = _clkMgr->getTime();
-                    _trace->dump( (vluint64_t)(time.s() / _timeprecision) );
+                    step<true>();
                 }
+                else
+                {
+                    step<false>();
+                }
+            }
 
-                //tick() clocks and eval logic
-                _clkMgr->tick();
+            /**
+             * @brief Run the testbench until a given time
+             * @details All clock events up to and including time are handled,
+             * the simulation time is not advanced past time.
+             * 
+             * @param[in] time  Absolute simulation time to run to
+             * @return true when time was reached, false when the simulation finished or no clock is running
+             */
+            bool runUntil(simtime_t time)
+            {
+                return runLoop([this, time] { return _clkMgr->getNextEventTime() > time; });
+            }
 
-                _core->eval();
+            /**
+             * @brief Run the testbench for a number of clock cycles
+             * 
+             * @param[in] clk       Clock to count positive edges of
+             * @param[in] n         Number of cycles to run
+             * @return true when n cycles ran, false when the simulation finished or no clock is running
+             */
+            bool runCycles(const cClock* clk, uint64_t n)
+            {
+                uint64_t cycles = clk->getCycleCount() + n;
+
+                return runLoop([clk, cycles] { return clk->getCycleCount() >= cycles; });
+            }
+
+            /**
+             * @brief Run the testbench until a condition holds
+             * @details The predicate is checked before every step
+             * 
+             * Usage: runUntil([&]{ return _core->done; });
+             * 
+             * @param[in] predicate Condition to stop running
+             * @return true when the predicate returned true, false when the simulation finished or no clock is running
+             */
+            template <std::predicate P>
+            bool runUntil(P predicate)
+            {
+                return runLoop(predicate);
             }
 
             /**
@@ -140,6 +375,23 @@ namespace testbench
                 _finished = true;
             }
 
+            /**
+             * @brief Finish a failed simulation
+             * @details When a flight recorder trace is open, the recorded trace 
+             * is written to disk. Calls finish(), including a derived override.
+             */
+            void finishFailed(void)
+            {
+                #if TRACE_HAS_VCD
+                if (_recorder)
+                {
+                    _recorder->save();
+                }
+                #endif
+
+                finish();
+            }
+
             /**
              * @brief Check if the system has finished
              * 
@@ -180,6 +432,50 @@ namespace testbench
                 return _clkMgr->add(Clock, Period, on);
             }
 
+            /**
+             * @brief Wait for a simulation time duration of this testbench
+             * @details Hides the free function in derived testbenches, so the
+             * timer is bound to this testbench's clock manager
+             * 
+             * @param[in] delay Time to wait from now
+             * @return The awaitable
+             */
+            cTimerAwaitable waitFor(simtime_t delay) const
+            {
+                return clock::waitFor(_clkMgr, delay);
+            }
+
+            /**
+             * @brief Wait until an absolute simulation time of this testbench
+             * 
+             * @param[in] time  Time to resume at
+             * @return The awaitable
+             */
+            cTimerAwaitable waitUntil(simtime_t time) const
+            {
+                return clock::waitUntil(_clkMgr, time);
+            }
+
+            /**
+             * @brief Wait for the next delta cycle of this testbench
+             * 
+             * @return The awaitable
+             */
+            cDeltaAwaitable waitDelta(void) const
+            {
+                return clock::waitDelta(_clkMgr);
+            }
+
+            /**
+             * @brief Mark the model inputs as changed
+             * @details When eval tracking is enabled, this must be called after
+             * driving model inputs outside of a clock or bus/peripheral driver.
+             */
+            void markInputsDirty(void) const
+            {
+                _clkMgr->markDirty();
+            }
+
             /**
              * @brief Return the precision of the simulation context
              * 
@@ -196,11 +492,23 @@ namespace testbench
              * 
              * @param[in] context           The verilated context the object exists in
              * @param[in] traceActive       Boolean to set the trace active or inactive
+             * @param[in] traceFormat       Format of the trace file, default VCD
              */
-            cTestBench(VerilatedContext* context, bool traceActive) :
+            cTestBench(VerilatedContext* context, bool traceActive, eTraceFormat traceFormat = eTraceFormat::VCD) :
                 _context(context),
+                _traceFormat(traceFormat),
+                _traceActive(traceActive),
                 _finished(false),
-                _traceActive(traceActive)
+                _evalTracking(false),
+                _evalCount(0),
+                _evalSaved(0),
+                _traceStart(0),
+                _traceStop(simtime_t::max()),
+                _traceClock(nullptr),
+                _traceStopCycle(0),
+                _traceSplitTime(0),
+                _traceSplitBytes(0),
+                _traceDepth(cTraceAllLevels)
             {
                 if(traceActive)
                 {
@@ -209,9 +517,15 @@ namespace testbench
 
                 _timeprecision = pow(10, 0 - context->timeprecision());
 
+                //simtime_t must be able to represent the context's precision
+                if (_timeprecision == 0)
+                {
+                    _timeprecision = simtime_t::fromTicks(1);
+                    ERROR << "Context timeprecision is finer than SIMTIME_PRECISION, trace times are in simtime_t ticks\n";
+                }
+
                 _core = new VM; // Create a new verilator model
-                _clkMgr = new cClockManager(_timeprecision); //Create new Clock Manager
-                _trace = nullptr;
+                _clkMgr = new cClockManager(); //Create new Clock Manager
             }
 
             /**
@@ -220,13 +534,21 @@ namespace testbench
              */
             virtual ~cTestBench(void)
             {
+                //Stop time stamping log messages with this testbench
+                if(common::cLog::getInstance()->getTimeInterface() == this)
+                {
+                    common::cLog::getInstance()->setTimeInterface(nullptr);
+                }
+
                 if(_traceActive)
                 {
                     closeTrace();
                 }
 
+                #ifdef DBG_TESTBENCH_H
                 //save time before we destroy object
                 simtime_t time = getTime();
+                #endif
 
                 //Final Cleanup
                 _core->final();
@@ -242,6 +564,7 @@ namespace testbench
 
             /**
              * @brief Open a trace file
+             * @details The trace is written in the format selected at construction
              * 
              * @param[in] fileName  Name of the trace file
              */
@@ -251,8 +574,21 @@ namespace testbench
                 {
                     if (!_trace) 
                     {
-                        _trace = new VerilatedVcdC;
-                        _core->trace(_trace, 99);
+                        _trace.reset(createTraceFile(_core, _traceFormat, traceLevels()));
+
+                        if (_traceSplitTime != 0 || _traceSplitBytes != 0)
+                        {
+                            //Both are integer ticks, convert to the trace's timeprecision
+                            uint64_t interval = _traceSplitTime.ticks() / _timeprecision.ticks();
+                            _trace.reset(new cSplitTraceFile(_trace.release(), interval, _traceSplitBytes, _traceChunkHandler));
+                        }
+
+                        if (!limitTrace())
+                        {
+                            _trace.reset();
+                            return;
+                        }
+
                         _trace->open(fileName);
                     }
                 }
@@ -267,6 +603,60 @@ namespace testbench
                 opentrace(fileName.c_str());
             }
 
+            #if TRACE_HAS_VCD
+            /**
+             * @brief Open a flight recorder trace
+             * @details Only the last part of the simulation is kept in memory, at 
+             * least the window and at most 1.5 times the window. The trace is 
+             * written to the file by finishFailed() or on the first FATAL message,
+             * a passing test writes nothing.
+             * 
+             * The flight recorder always writes VCD.
+             * 
+             * @param[in] fileName  Name of the trace file
+             * @param[in] window    Simulation time to keep
+             */
+            void opentraceRecorder(const char *fileName, simtime_t window)
+            {
+                if(_traceActive)
+                {
+                    if (!_trace) 
+                    {
+                        if (_traceFormat != eTraceFormat::VCD)
+                        {
+                            ERROR << "Flight recorder only supports VCD, using VCD\n";
+                        }
+
+                        //The window is covered by two completed chunks and the current one
+                        uint64_t chunkLength = window.ticks() / _timeprecision.ticks() / 2;
+
+                        _recorder = new cTraceRecorder(_core, traceLevels(), chunkLength ? chunkLength : 1, 2);
+                        _trace.reset(_recorder);
+
+                        if (!limitTrace())
+                        {
+                            _trace.reset();
+                            _recorder = nullptr;
+                            return;
+                        }
+
+                        _trace->open(fileName);
+
+                        common::cLog::getInstance()->setFatalHandler([this]() { _recorder->save(); });
+                    }
+                }
+                else
+                {
+                    ERROR << "Trace is not active, no need to open";
+                }
+            }
+
+            void opentraceRecorder(std::string fileName, simtime_t window)
+            {
+                opentraceRecorder(fileName.c_str(), window);
+            }
+            #endif
+
             /**
              * @brief Close any open trace
              * 
@@ -275,12 +665,173 @@ namespace testbench
             {
                 if (_trace) 
                 {
+                    #if TRACE_HAS_VCD
+                    if (_recorder)
+                    {
+                        common::cLog::getInstance()->setFatalHandler(nullptr);
+                        _recorder = nullptr;
+                    }
+                    #endif
+
                     _trace->flush();
                     _trace->close();
-                    _trace = NULL;
+                    _trace.reset();
                 }
             }
 
+            /**
+             * @brief Split the trace into multiple files
+             * @details Must be called before opentrace(). The trace is written to 
+             * name_0001.vcd, name_0002.vcd, ... where name is the file name passed
+             * to opentrace() without extension, see cSplitTraceFile.
+             * 
+             * @param[in] interval  Simulation time per file, 0 to not split on time
+             * @param[in] bytes     Size per file, 0 to not split on size
+             */
+            void splitTrace(simtime_t interval, uint64_t bytes = 0)
+            {
+                _traceSplitTime  = interval;
+                _traceSplitBytes = bytes;
+            }
+
+            /**
+             * @brief Set the number of hierarchy levels to trace
+             * @details Must be called before opentrace(). Without scopes the levels 
+             * are counted from the top of the model, with scopes from each scope.
+             * 
+             * @param[in] levels    Number of hierarchy levels, 0 or cTraceAllLevels for all
+             */
+            void traceDepth(int levels)
+            {
+                _traceDepth = levels;
+            }
+
+            /**
+             * @brief Only trace the signals in the scopes
+             * @details Must be called before opentrace(). The scopes are hierarchical
+             * names as in the trace, e.g. TOP.soc.bus. Only the dump cost of the
+             * traced scopes is paid.
+             * 
+             * Tracing scopes needs Verilator 5, and Verilator cannot exclude scopes
+             * at runtime. Otherwise opentrace() fails with ERROR instead of silently
+             * tracing everything. Use the verilator tracing_off metacomment to exclude scopes.
+             * 
+             * Usage: cScopeOption scopes("s", "trace-scope", "Scopes to trace");
+             *        tb->traceScopes(scopes.includes(), scopes.excludes());
+             * 
+             * @param[in] include   Scopes to trace, empty for all
+             * @param[in] exclude   Scopes not to trace
+             */
+            void traceScopes(const std::vector<std::string>& include, const std::vector<std::string>& exclude = {})
+            {
+                _traceScopes   = include;
+                _traceExcludes = exclude;
+            }
+
+            /**
+             * @brief Set the handler for closed trace files
+             * @details Must be called before opentrace(). The handler is called with
+             * the name of every trace file that is closed by splitTrace() rollover or
+             * by closeTrace(), e.g. to compress it on another thread while the 
+             * simulation continues.
+             * 
+             * @param handler   The handler, nullptr to remove it
+             */
+            void onTraceChunk(cSplitTraceFile::chunkHandler_t handler)
+            {
+                _traceChunkHandler = std::move(handler);
+            }
+
+            /**
+             * @brief Only trace within a time window
+             * @details The trace is dumped from start up to, not including, stop.
+             * Outside the window the open trace is not dumped, so runs only pay 
+             * for dumping the window.
+             * 
+             * By default the window is the whole simulation.
+             * 
+             * @param[in] start     Absolute simulation time to start tracing
+             * @param[in] stop      Absolute simulation time to stop tracing
+             */
+            void traceWindow(simtime_t start, simtime_t stop = simtime_t::max())
+            {
+                _traceStart = start;
+                _traceStop  = stop;
+                _traceClock = nullptr;
+            }
+
+            /**
+             * @brief Start tracing now
+             * @details Can be called from a coroutine when a trigger occurs,
+             * e.g. after co_await waitSignal(error, 1, clk);
+             */
+            void startTrace(void)
+            {
+                traceWindow(_clkMgr->getTime());
+            }
+
+            /**
+             * @brief Stop tracing now
+             */
+            void stopTrace(void)
+            {
+                traceWindow(_traceStart, _clkMgr->getTime());
+
+                if (_trace)
+                {
+                    _trace->flush();
+                }
+            }
+
+            /**
+             * @brief Start tracing now and stop after a number of clock cycles
+             * 
+             * Usage: co_await waitSignal(error, 1, clk); tb->traceCycles(clk, 1000);
+             * 
+             * @param[in] clk   Clock to count positive edges of
+             * @param[in] n     Number of cycles to trace
+             */
+            void traceCycles(const cClock* clk, uint64_t n)
+            {
+                startTrace();
+                _traceClock = clk;
+                _traceStopCycle = clk->getCycleCount() + n;
+            }
+
+            /**
+             * @brief Enable or disable eval tracking
+             * @details With eval tracking enabled, tick() only evaluates the model
+             * when a clock toggled or inputs were marked as changed. All drivers 
+             * that change model inputs must then call markInputsDirty().
+             * 
+             * @param[in] on    Enable eval tracking
+             */
+            void evalTracking(bool on)
+            {
+                _evalTracking = on;
+                _clkMgr->markDirty();
+            }
+
+            /**
+             * @brief Get the number of model evaluations
+             * 
+             * @return Number of times eval() was called on the model
+             */
+            uint64_t getEvalCount(void) const
+            {
+                return _evalCount;
+            }
+
+            /**
+             * @brief Get the number of skipped model evaluations
+             * 
+             * @return Number of evaluations skipped by eval tracking
+             */
+            uint64_t getEvalsSaved(void) const
+            {
+                return _evalSaved;
+            }
+
             /**
              * @brief Get the runtime of the simulation
              * 
@@ -0,0 +1,549 @@
+/////////////////////////////////////////////////////////////////////
+//   ,------.                    ,--.                ,--.          //
+//   |  .--. ' ,---.  ,--,--.    |  |    ,---. ,---. `--' ,---.    //
+//   |  '--'.'| .-. |' ,-.  |    |  |   | .-. | .-. |,--.| .--'    //
+//   |  |\  \ ' '-' '\ '-'  |    |  '--.' '-' ' '-' ||  |\ `--.    //
+//   `--' '--' `---'  `--`--'    `-----' `---' `-   /`--' `---'    //
+//                                             `---'               //
+//    Trace File Backends                                          //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//             Copyright (C) 2024 Roa Logic BV                     //
+//             www.roalogic.com                                    //
+//                                                                 //
+//     This source file may be used and distributed without        //
+//   restriction provided that this copyright statement is not     //
+//   removed from the file and that any derivative work contains   //
+//   the original copyright notice and the associated disclaimer.  //
+//                                                                 //
+//      THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY        //
+//   EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED     //
+//   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS     //
+//   FOR A PARTICULAR PURPOSE. IN NO EVENT SHALL THE AUTHOR        //
+//   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,           //
+//   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES      //
+//   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE     //
+//   GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR          //
+//   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    //
+//   LIABILITY, WHETHER IN  CONTRACT, STRICT LIABILITY, OR TORT    //
+//   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT    //
+//   OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE           //
+//   POSSIBILITY OF SUCH DAMAGE.                                   //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+//For Verilator methods
+#include <verilated.h>
+
+/*
+ * Verilator defines VM_TRACE_FST when the model is verilated with --trace-fst,
+ * and VM_TRACE_VCD (Verilator 5) when it is verilated with --trace.
+ */
+#if VM_TRACE_FST
+#include <verilated_fst_c.h>
+#define TRACE_HAS_FST 1
+#endif
+
+#if VM_TRACE_VCD || !VM_TRACE_FST
+#include <verilated_vcd_c.h>
+#define TRACE_HAS_VCD 1
+#endif
+
+/*
+ * Verilator 5 can limit the trace to scopes at runtime with dumpvars()
+ */
+#if defined(VERILATOR_VERSION_INTEGER) && VERILATOR_VERSION_INTEGER >= 5000000
+#define TRACE_HAS_DUMPVARS 1
+#endif
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+//For the flight recorder chunks
+#include "buffer.hpp"
+
+//For logging
+#include "log.hpp"
+
+namespace RoaLogic
+{
+namespace testbench
+{
+    /**
+     * @brief Number of hierarchy levels that traces all of a model
+     */
+    constexpr int cTraceAllLevels = 99;
+
+    /**
+     * @brief Trace file formats
+     */
+    enum class eTraceFormat
+    {
+        VCD,    //!< Value Change Dump, text
+        FST     //!< Fast Signal Trace, compressed binary, needs --trace-fst
+    };
+
+    /**
+     * @class cTraceFile
+     * @author Richard Herveille
+     * @brief Trace file interface
+     * 
+     * @details Hides the Verilator trace class of the selected format from the
+     * testbench. The trace classes are not derived from a common base with 
+     * virtual functions, so they are wrapped in cVerilatedTraceFile.
+     * 
+     * Verilator can offload writing the trace to a separate thread, the model 
+     * must then be verilated with --trace-threads. dump() only copies the changed
+     * values into a buffer and the file is written on the trace thread.
+     */
+    class cTraceFile
+    {
+        public:
+        virtual ~cTraceFile() = default;
+
+        virtual void open(const char* fileName) = 0;
+        virtual void dump(uint64_t time) = 0;
+        virtual void flush(void) = 0;
+        virtual void close(void) = 0;
+        virtual bool isOpen(void) const = 0;
+
+        /**
+         * @brief Only trace the signals in a scope
+         * @details Can be called for multiple scopes, must be called before open().
+         * Without any call all scopes are traced. Verilator clears the selection 
+         * when levels is 0, use cTraceAllLevels for all levels.
+         * 
+         * @param[in] levels    Number of hierarchy levels in the scope to trace, at least 1
+         * @param[in] scope     Hierarchical name of the scope, e.g. TOP.soc.bus, empty for the top
+         * @return false when the Verilator version cannot limit the trace
+         */
+        virtual bool dumpvars(int levels, const std::string& scope) = 0;
+
+        /**
+         * @brief File name extension of the format, including the dot
+         */
+        virtual const char* extension(void) const = 0;
+    };
+
+    /**
+     * @class cVerilatedTraceFile
+     * @brief Trace file using a Verilator trace class
+     * 
+     * @tparam T    The Verilator trace class, VerilatedVcdC or VerilatedFstC
+     */
+    template <class T> class cVerilatedTraceFile final : public cTraceFile
+    {
+        private:
+        T           _trace;      //!< Verilator trace object
+        const char* _extension;  //!< File name extension
+
+        public:
+        /**
+         * @brief Construct a trace file and register the model's signals
+         * 
+         * @param[in] core      The verilated model
+         * @param[in] levels    Number of hierarchy levels to trace
+         * @param[in] extension File name extension of the format
+         */
+        template <class VM>
+        cVerilatedTraceFile(VM* core, int levels, const char* extension) : _extension(extension)
+        {
+            core->trace(&_trace, levels);
+        }
+
+        void open(const char* fileName) override { _trace.open(fileName); }
+        void dump(uint64_t time)        override { _trace.dump(time); }
+        void flush(void)                override { _trace.flush(); }
+        void close(void)                override { _trace.close(); }
+        bool isOpen(void) const         override { return _trace.isOpen(); }
+
+        bool dumpvars(int levels, const std::string& scope) override
+        {
+            #if TRACE_HAS_DUMPVARS
+            _trace.dumpvars(levels, scope);
+            return true;
+            #else
+            return false;
+            #endif
+        }
+
+        const char* extension(void) const override { return _extension; }
+    };
+
+    /**
+     * @class cSplitTraceFile
+     * @author Richard Herveille
+     * @brief Trace split into multiple files
+     * 
+     * @details Writes the trace of another trace file to name_0001.vcd, 
+     * name_0002.vcd, ... where name is the file name passed to open() without
+     * extension. A new file is started when the open file covers the time
+     * interval or reached the size. Closing writes the whole file, the next one 
+     * starts with the header and a full dump of all values. So each file can be 
+     * viewed, moved or compressed on its own.
+     * 
+     * The size is checked every cSizeCheck dumps, it includes what the trace 
+     * has written to the file so far, not what it still buffers.
+     */
+    class cSplitTraceFile final : public cTraceFile
+    {
+        public:
+        typedef std::function<void(const std::string&)> chunkHandler_t;
+
+        static constexpr uint64_t cSizeCheck = 1024; //!< Number of dumps between file size checks
+
+        private:
+        std::unique_ptr<cTraceFile> _trace;    //!< Trace that is split
+        uint64_t       _interval;              //!< Trace time per file, 0 when not splitting on time
+        uint64_t       _bytes;                 //!< Size of a file, 0 when not splitting on size
+        chunkHandler_t _handler;               //!< Called with each closed file
+        std::string    _baseName;              //!< File name without extension
+        std::string    _chunkName;             //!< Name of the open file
+        unsigned       _chunk;                 //!< Number of the open file
+        uint64_t       _chunkStart;            //!< Trace time of the first dump in the open file
+        uint64_t       _dumps;                 //!< Number of dumps into the open file
+
+        /**
+         * @brief Check if the open file is complete
+         * 
+         * @param[in] time  Trace time of the next dump
+         * @return true when the next dump should go into a new file
+         */
+        bool chunkDone(uint64_t time)
+        {
+            if (_dumps == 0)
+            {
+                _chunkStart = time;
+                return false;
+            }
+
+            if (_interval != 0 && time - _chunkStart >= _interval)
+            {
+                return true;
+            }
+
+            if (_bytes != 0 && _dumps % cSizeCheck == 0)
+            {
+                std::error_code ec;
+                return std::filesystem::file_size(_chunkName, ec) >= _bytes && !ec;
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Open the next file
+         */
+        void openChunk(void)
+        {
+            std::ostringstream name;
+            name << _baseName << '_' << std::setw(4) << std::setfill('0') << ++_chunk << _trace->extension();
+
+            _chunkName = name.str();
+            _dumps = 0;
+            _trace->open(_chunkName.c_str());
+        }
+
+        /**
+         * @brief Close the open file and report it to the handler
+         */
+        void closeChunk(void)
+        {
+            _trace->close();
+
+            if (_handler)
+            {
+                _handler(_chunkName);
+            }
+        }
+
+        public:
+        /**
+         * @brief Construct a split trace
+         * 
+         * @param[in] trace     The trace to split, owned by this object
+         * @param[in] interval  Trace time per file, 0 to not split on time
+         * @param[in] bytes     Size per file, 0 to not split on size
+         * @param[in] handler   Called with the name of each closed file, may be empty
+         */
+        cSplitTraceFile(cTraceFile* trace, uint64_t interval, uint64_t bytes, chunkHandler_t handler) :
+            _trace(trace),
+            _interval(interval),
+            _bytes(bytes),
+            _handler(std::move(handler)),
+            _chunk(0),
+            _chunkStart(0),
+            _dumps(0)
+        {
+        }
+
+        void open(const char* fileName) override
+        {
+            //Strip the extension, it is added after the file number
+            _baseName = fileName;
+            std::string extension = _trace->extension();
+
+            if (_baseName.ends_with(extension))
+            {
+                _baseName.resize(_baseName.size() - extension.size());
+            }
+
+            _chunk = 0;
+            openChunk();
+        }
+
+        void dump(uint64_t time) override
+        {
+            if (chunkDone(time))
+            {
+                closeChunk();
+                openChunk();
+                _chunkStart = time;
+            }
+
+            _dumps++;
+            _trace->dump(time);
+        }
+
+        void close(void) override
+        {
+            if (_trace->isOpen())
+            {
+                closeChunk();
+            }
+        }
+
+        void flush(void)                override { _trace->flush(); }
+        bool isOpen(void) const         override { return _trace->isOpen(); }
+        const char* extension(void) const override { return _trace->extension(); }
+
+        bool dumpvars(int levels, const std::string& scope) override
+        {
+            return _trace->dumpvars(levels, scope);
+        }
+    };
+
+    #if TRACE_HAS_VCD
+    /**
+     * @class cTraceRecorder
+     * @author Richard Herveille
+     * @brief Flight recorder trace, keeps the last part of a VCD trace in memory
+     * 
+     * @details The trace is written into memory in chunks of a fixed trace time. 
+     * At the start of every chunk the trace is reopened, so each chunk starts with
+     * a full dump of all values and does not depend on earlier chunks. The completed
+     * chunks are kept in a ringbuffer which drops the oldest chunk when it is full.
+     * 
+     * The VCD header is only written when the trace is opened, it is kept apart
+     * from the chunks.
+     * 
+     * Nothing is written to disk until save() is called, e.g. when a test fails.
+     * save() writes the header, the kept chunks and the current one as a single VCD file.
+     * 
+     * Only VCD is supported, Verilator offers no hook to write an FST trace into memory.
+     */
+    class cTraceRecorder final : public cTraceFile
+    {
+        private:
+        /**
+         * @brief Verilator VCD file that writes into the current chunk
+         */
+        class cMemoryFile final : public VerilatedVcdFile
+        {
+            private:
+            cTraceRecorder* _recorder;
+
+            public:
+            cMemoryFile(cTraceRecorder* recorder) : _recorder(recorder) {};
+
+            bool open(const std::string& /*name*/) override
+            {
+                _recorder->nextChunk();
+                return true;
+            }
+
+            void close() override {}
+
+            ssize_t write(const char* bufp, ssize_t len) override
+            {
+                _recorder->_current.append(bufp, len);
+                return len;
+            }
+        };
+
+        common::ringbuffer<std::string> _chunks;  //!< Completed chunks, oldest first
+        std::string   _header;                    //!< VCD header, up to and including $enddefinitions
+        std::string   _current;                   //!< Chunk being written
+        std::string   _fileName;                  //!< File written by save()
+        uint64_t      _chunkLength;               //!< Trace time per chunk
+        uint64_t      _chunkStart;                //!< Trace time of the first dump in the current chunk
+        bool          _started;                   //!< The current chunk has a dump
+        cMemoryFile   _file;                      //!< Memory file of the trace
+        VerilatedVcdC _trace;                     //!< Verilator trace object, must follow _file
+
+        /**
+         * @brief Start a new chunk
+         * @details Called when the trace (re)opens the file, the current
+         * chunk is moved into the ringbuffer
+         */
+        void nextChunk(void)
+        {
+            if (!_current.empty())
+            {
+                _chunks.push_back(std::move(_current));
+                _current.clear();
+            }
+
+            _started = false;
+        }
+
+        public:
+        /**
+         * @brief Construct a flight recorder trace and register the model's signals
+         * 
+         * @param[in] core          The verilated model
+         * @param[in] levels        Number of hierarchy levels to trace
+         * @param[in] chunkLength   Trace time per chunk
+         * @param[in] chunks        Number of completed chunks to keep
+         */
+        template <class VM>
+        cTraceRecorder(VM* core, int levels, uint64_t chunkLength, size_t chunks) :
+            _chunks(chunks),
+            _chunkLength(chunkLength),
+            _chunkStart(0),
+            _started(false),
+            _file(this),
+            _trace(&_file)
+        {
+            core->trace(&_trace, levels);
+        }
+
+        void open(const char* fileName) override
+        {
+            _fileName = fileName;
+            _trace.open(fileName);
+
+            //open() writes the header, reopening for the next chunk does not
+            _trace.flush();
+
+            size_t end = _current.find("$enddefinitions");
+            if (end != std::string::npos)
+            {
+                end = _current.find('\n', end);
+                end = (end == std::string::npos) ? _current.size() : end + 1;
+
+                _header = _current.substr(0, end);
+                _current.erase(0, end);
+            }
+        }
+
+        void dump(uint64_t time) override
+        {
+            if (!_started)
+            {
+                _started = true;
+                _chunkStart = time;
+            }
+            else if (time - _chunkStart >= _chunkLength)
+            {
+                //Reopen, the next dump writes all values
+                _trace.openNext(false);
+                _started = true;
+                _chunkStart = time;
+            }
+
+            _trace.dump(time);
+        }
+
+        void flush(void)                override { _trace.flush(); }
+        void close(void)                override { _trace.close(); }
+        bool isOpen(void) const         override { return _trace.isOpen(); }
+
+        bool dumpvars(int levels, const std::string& scope) override
+        {
+            #if TRACE_HAS_DUMPVARS
+            _trace.dumpvars(levels, scope);
+            return true;
+            #else
+            return false;
+            #endif
+        }
+
+        const char* extension(void) const override { return ".vcd"; }
+
+        /**
+         * @brief Write the recorded trace to the file
+         * 
+         * @return true when the file was written
+         */
+        bool save(void)
+        {
+            _trace.flush();
+
+            std::ofstream out(_fileName, std::ios::binary);
+            if (!out)
+            {
+                ERROR << "Cannot write trace " << _fileName << "\n";
+                return false;
+            }
+
+            out << _header;
+
+            for (auto span : _chunks.read_spans())
+            {
+                for (const auto& chunk : span)
+                {
+                    out << chunk;
+                }
+            }
+
+            out << _current;
+
+            return out.good();
+        }
+    };
+    #endif
+
+    /**
+     * @brief Create a trace file for a model
+     * @details When the model is not verilated with support for the format, 
+     * the format the model supports is used instead.
+     * 
+     * @param[in] core      The verilated model
+     * @param[in] format    The trace file format
+     * @param[in] levels    Number of hierarchy levels to trace
+     * @return The trace file, not yet opened
+     */
+    template <class VM>
+    cTraceFile* createTraceFile(VM* core, eTraceFormat format, int levels)
+    {
+        if (format == eTraceFormat::FST)
+        {
+            #if TRACE_HAS_FST
+            return new cVerilatedTraceFile<VerilatedFstC>(core, levels, ".fst");
+            #else
+            ERROR << "FST trace needs a model verilated with --trace-fst, using VCD\n";
+            #endif
+        }
+
+        #if TRACE_HAS_VCD
+        return new cVerilatedTraceFile<VerilatedVcdC>(core, levels, ".vcd");
+        #else
+        ERROR << "VCD trace needs a model verilated with --trace, using FST\n";
+        return new cVerilatedTraceFile<VerilatedFstC>(core, levels, ".fst");
+        #endif
+    }
+}
+}
+
+#endif
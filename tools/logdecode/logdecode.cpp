@@ -0,0 +1,280 @@
+/////////////////////////////////////////////////////////////////////
+//   ,------.                    ,--.                ,--.          //
+//   |  .--. ' ,---.  ,--,--.    |  |    ,---. ,---. `--' ,---.    //
+//   |  '--'.'| .-. |' ,-.  |    |  |   | .-. | .-. |,--.| .--'    //
+//   |  |\  \ ' '-' '\ '-'  |    |  '--.' '-' ' '-' ||  |\ `--.    //
+//   `--' '--' `---'  `--`--'    `-----' `---' `-   /`--' `---'    //
+//                                             `---'               //
+//    Binary Log Decoder                                           //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//             Copyright (C) 2024 Roa Logic BV                     //
+//             www.roalogic.com                                    //
+//                                                                 //
+//     This source file may be used and distributed without        //
+//   restriction provided that this copyright statement is not     //
+//   removed from the file and that any derivative work contains   //
+//   the original copyright notice and the associated disclaimer.  //
+//                                                                 //
+//      THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY        //
+//   EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED     //
+//   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS     //
+//   FOR A PARTICULAR PURPOSE. IN NO EVENT SHALL THE AUTHOR        //
+//   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,           //
+//   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES      //
+//   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE     //
+//   GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR          //
+//   BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    //
+//   LIABILITY, WHETHER IN  CONTRACT, STRICT LIABILITY, OR TORT    //
+//   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT    //
+//   OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE           //
+//   POSSIBILITY OF SUCH DAMAGE.                                   //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+
+/*
+ * Renders a binary log, written after cLog::startBinary(), as text
+ *
+ * Usage: logdecode <binary log> [<text file>]
+ *
+ * Build: see README.md
+ */
+
+#include <logformat.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+using namespace RoaLogic::common;
+
+/**
+ * @brief A format record
+ */
+struct sFormat
+{
+    uint8_t                 priority;
+    std::vector<eBinLogArg> args;
+    std::string             format;
+};
+
+/**
+ * @brief Reads values from the log file contents
+ */
+class cReader
+{
+    private:
+    const std::string& _data;
+    size_t _pos;
+
+    public:
+    cReader(const std::string& data) : _data(data), _pos(0) {};
+
+    bool done() const { return _pos >= _data.size(); }
+
+    template <typename T>
+    T get()
+    {
+        T value;
+
+        if (_pos + sizeof(T) > _data.size())
+        {
+            throw std::runtime_error("Truncated log file");
+        }
+
+        std::memcpy(&value, _data.data() + _pos, sizeof(T));
+        _pos += sizeof(T);
+        return value;
+    }
+
+    std::string_view getString(size_t length)
+    {
+        if (_pos + length > _data.size())
+        {
+            throw std::runtime_error("Truncated log file");
+        }
+
+        std::string_view str(_data.data() + _pos, length);
+        _pos += length;
+        return str;
+    }
+};
+
+/**
+ * @brief Priority prefix, as written by cLog
+ */
+static const char* prefix(uint8_t priority)
+{
+    static const char* prefixes[] = {"[DEBUG] ", "[LOG] ", "[INFO] ", "[WARNING] ", "[ERROR] ", "[FATAL] ", ""};
+    return priority < std::size(prefixes) ? prefixes[priority] : "";
+}
+
+/**
+ * @brief Render an argument
+ */
+static void renderArg(std::string& out, cReader& in, eBinLogArg type)
+{
+    switch (type)
+    {
+        case eBinLogArg::Bool   : out += std::to_string(in.get<bool    >()); break;
+        case eBinLogArg::Char   : out += in.get<char>();                      break;
+        case eBinLogArg::Int8   : out += std::to_string(in.get<int8_t  >()); break;
+        case eBinLogArg::UInt8  : out += std::to_string(in.get<uint8_t >()); break;
+        case eBinLogArg::Int16  : out += std::to_string(in.get<int16_t >()); break;
+        case eBinLogArg::UInt16 : out += std::to_string(in.get<uint16_t>()); break;
+        case eBinLogArg::Int32  : out += std::to_string(in.get<int32_t >()); break;
+        case eBinLogArg::UInt32 : out += std::to_string(in.get<uint32_t>()); break;
+        case eBinLogArg::Int64  : out += std::to_string(in.get<int64_t >()); break;
+        case eBinLogArg::UInt64 : out += std::to_string(in.get<uint64_t>()); break;
+
+        case eBinLogArg::Float  :
+        case eBinLogArg::Double :
+        {
+            double value = (type == eBinLogArg::Float) ? in.get<float>() : in.get<double>();
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%g", value);
+            out += buf;
+            break;
+        }
+
+        case eBinLogArg::String :
+            out += in.getString(in.get<uint32_t>());
+            break;
+
+        default:
+            throw std::runtime_error("Unknown argument type");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <binary log> [<text file>]\n";
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot open " << argv[1] << "\n";
+        return 1;
+    }
+
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::ofstream outFile;
+    if (argc > 2)
+    {
+        outFile.open(argv[2]);
+    }
+    std::ostream& out = (argc > 2) ? outFile : std::cout;
+
+    try
+    {
+        cReader in(data);
+
+        if (in.getString(sizeof(cBinLogMagic)) != std::string_view(cBinLogMagic, sizeof(cBinLogMagic)))
+        {
+            throw std::runtime_error("Not a binary log file");
+        }
+
+        if (in.get<uint32_t>() != cBinLogVersion)
+        {
+            throw std::runtime_error("Unsupported binary log version");
+        }
+
+        int precision = 0;
+
+        std::map<uint32_t, sFormat> formats;
+        std::string line;
+
+        while (!in.done())
+        {
+            switch (in.get<eBinLogRecord>())
+            {
+                case eBinLogRecord::Format:
+                {
+                    uint32_t id = in.get<uint32_t>();
+                    sFormat& f = formats[id];
+
+                    f.priority = in.get<uint8_t>();
+                    f.args.resize(in.get<uint8_t>());
+                    for (auto& arg : f.args)
+                    {
+                        arg = in.get<eBinLogArg>();
+                    }
+                    f.format = in.getString(in.get<uint32_t>());
+                    break;
+                }
+
+                case eBinLogRecord::Message:
+                {
+                    auto it = formats.find(in.get<uint32_t>());
+                    if (it == formats.end())
+                    {
+                        throw std::runtime_error("Message with unknown format");
+                    }
+
+                    const sFormat& f = it->second;
+                    int64_t ticks = in.get<int64_t>();
+
+                    line = prefix(f.priority);
+                    if (ticks != cBinLogNoTime)
+                    {
+                        line += "@";
+                        formatSimTicks(line, ticks, precision);
+                        line += " ";
+                    }
+
+                    //replace every {} by the next argument
+                    std::string_view fmt(f.format);
+                    size_t pos = 0;
+
+                    for (auto arg : f.args)
+                    {
+                        size_t p = fmt.find("{}", pos);
+
+                        if (p == std::string_view::npos)
+                        {
+                            std::string skip;
+                            renderArg(skip, in, arg);
+                            continue;
+                        }
+
+                        line += fmt.substr(pos, p - pos);
+                        renderArg(line, in, arg);
+                        pos = p + 2;
+                    }
+
+                    line += fmt.substr(pos);
+                    out << line;
+                    break;
+                }
+
+                case eBinLogRecord::Text:
+                    out << in.getString(in.get<uint32_t>());
+                    break;
+
+                case eBinLogRecord::Precision:
+                    precision = in.get<int8_t>();
+                    break;
+
+                default:
+                    throw std::runtime_error("Unknown record type");
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        out.flush();
+        std::cerr << "logdecode: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}